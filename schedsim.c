@@ -11,124 +11,876 @@
 #include <semaphore.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
 #include <getopt.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
 
 // Constants
-#define MAX_PROCESSES 100
-#define BUFFER_SIZE 256
-#define MAX_GANTT (MAX_PROCESSES * 100)
+#define MAX_PARSE_ERRORS 10 // malformed rows reported before going quiet
+#define PARSE_CHUNKS_PER_THREAD 4 // chunks per parse thread, evens out uneven rows
+#define PARSE_MIN_CHUNK (1 << 20) // smaller inputs are not worth splitting
+#define ARENA_ALIGN 16
+#define ARENA_MIN_BLOCK (64 * 1024)
+#define EST_ROW_BYTES 12 // rough size of one CSV row, used to presize storage
+#define GANTT_PER_PROCESS 2 // initial Gantt entries reserved per process
+#define GANTT_IDLE UINT32_MAX // pid_id of an idle segment
+#define GANTT_COMPACT_BYTES 3 // initial bytes reserved per segment by --gantt-compact
+#define CFS_LATENCY 24        // default target latency (time units)
+#define CFS_MIN_GRANULARITY 3 // default minimum slice (time units)
+#define MLFQ_MAX_LEVELS 64   // one bit per level in the MLFQ bitmap
+#define MLFQ_LEVELS 3        // default number of MLFQ levels
+#define MLFQ_BOOST 100       // default MLFQ priority boost period (time units)
+#define STRIDE_ONE (1 << 20) // stride of a one-ticket process, larger ticket counts divide it
+#define BALANCE_INTERVAL 4   // default time between work-stealing passes
+#define MAX_CPUS 1024
+#define STREAM_SLOTS 1024 // process slots a streaming run starts with, doubled when more are live
+#define GENERATED_ROWS 1024 // table rows lazily generated input starts with, doubled as it arrives
+#define STREAM_RELEASE (4 << 20) // streamed input is dropped from memory this many bytes at a time
+#define STREAM_NAME 24 // bytes per slot for the name of a generated row
+#define GANTT_BAND 16 // Gantt entries per printed band when streaming
+#define HIST_SUB_BITS 7 // latency histograms: 2^6 buckets per power of two, under 1.6% error
+#define HIST_HALF (1 << (HIST_SUB_BITS - 1))
+#define HIST_BUCKETS ((33 - HIST_SUB_BITS) * HIST_HALF) // enough for any non-negative int
+#define QUEUE_CROSSOVER 192 // keyed queues switch from flat scan to heap above this,
+                            // measured with `schedsim bench-queue`
 
 // Scheduling Algorithms
 typedef enum {
     FCFS,
     SJF,
     RR,
-    PRIORITY
+    PRIORITY,
+    SRTF, // preemptive SJF, shortest remaining time first
+    CFS,  // completely fair scheduling on virtual runtime
+    MLFQ, // multilevel feedback queue
+    EDF,  // preemptive earliest deadline first
+    LOTTERY, // proportional share, random draw weighted by tickets
+    STRIDE   // proportional share, deterministic by pass value
 } SchedulingAlgorithm;
 
-// Process structure (individual process info)
+// A scheduling policy is a set of hooks the scheduler loop calls at fixed
+// points. The loop is instantiated once per policy (POLICY_LOOP) with the
+// hooks known at compile time, so they are inlined and the loop carries no
+// per-event algorithm checks. Adding a policy means writing its hooks and
+// registering it in policy_table, not editing the loop.
+typedef struct {
+    const char* name;
+    void (*init)(void);                      // set up the ready queue
+    void (*on_arrival)(int process);         // a process is admitted
+    int (*select)(void);                     // pick and remove the next process, -1 if none
+    int (*should_preempt)(int process);      // the running process should give up the CPU
+    void (*on_preempt)(int process);         // the running process goes back to ready
+    int (*time_slice)(int process);          // most units to run before checking again
+    void (*on_tick)(int process, int units); // the running process ran `units`
+    void (*on_complete)(int process);        // the running process finished
+    int (*steal)(void);                      // remove a waiting process for another CPU, -1 if none
+    void (*on_grow)(int old_count);          // the table grew past old_count processes (--stream)
+} SchedulingPolicy;
+
+// Execution engines
+typedef enum {
+    ENGINE_DIRECT,  // scheduler runs the work inline, no threads
+    ENGINE_THREADED // one pthread per process, semaphore handoff per dispatch
+} ExecutionEngine;
+
+// Load balancing with more than one CPU
+typedef enum {
+    BALANCE_GLOBAL, // one ready queue shared by every CPU
+    BALANCE_STEAL   // a run queue per CPU, idle CPUs steal from the longest
+} BalanceMode;
+
+// Process table, stored as a struct of arrays indexed by process number.
+// The hot columns are the ones the dispatch path touches on every event
+// (admission, selection, preemption, execution), so a scan over them stays
+// in a few cache lines. The cold columns are input only read when printing
+// and the per-process results.
+typedef struct {
+    // hot
+    int* arrival;
+    int* remaining_time;
+    int* priority;
+    int* queue_index;   // slot in the ready queue heap (heap queues only)
+    uint8_t* flags;     // PROCESS_IN_READY_QUEUE, PROCESS_FINISHED
+    // cold
+    uint32_t* pid_id;   // interned name, see pid_name()
+    int* burst;
+    int* start_time;
+    int* finish_time;
+    int* deadline;      // absolute, NO_DEADLINE when the row has none
+} ProcessTable;
+
+#define PROCESS_IN_READY_QUEUE 0x1
+#define PROCESS_FINISHED 0x2
+#define NO_DEADLINE INT_MAX // sorts after every real deadline in EDF
+
+// Per-process thread state, only allocated by the threaded engine
 typedef struct {
-    // Process info (given in CSV)
-    char pid[32];
-    int arrival;
-    int burst;
-    int priority;
-    
-    // dyanamic info per process
-    int remaining_time;
     sem_t semaphore;
     pthread_t thread;
-    
-    // metrics
-    int start_time;
-    int finish_time;
-    int waiting_time;
-    int response_time;
-    int turnaround_time;
-    
-    // helper flags
-    int started; 
-    int finished;
-    int in_ready_queue;
-} Process;
+    int run_units; // units granted by the scheduler for the current dispatch
+    int run_start; // time the dispatch starts
+} ProcessThread;
+
+// Arena: a chain of large blocks handed out with a bump pointer. Everything
+// sized by the input (process table, arrival order, ready queue, Gantt chart)
+// lives here and is released in one go by arena_free_all().
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t size;
+    size_t used;
+    char data[];
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock* head;
+    void* last;       // most recent allocation, can be grown in place
+    size_t last_size;
+} Arena;
+
+// PID names are interned once at load time. Everything else carries the
+// 32-bit id and only the printers resolve it back to a name. Names are
+// slices of the mapped input, not copies.
+typedef struct {
+    const char* start;
+    uint32_t len;
+    uint32_t hash;
+} PidSlice;
+
+// Hash slot. The hash sits next to the id so probing never has to touch
+// the names.
+typedef struct {
+    uint32_t hash;
+    uint32_t id; // id + 1, 0 = empty
+} PidSlot;
+
+typedef struct {
+    PidSlice* names;    // indexed by pid id
+    uint32_t count;
+    uint32_t capacity;
+    PidSlot* slots;     // open addressing
+    uint32_t slot_mask;
+} PidTable;
+
+// A slice of the input, cut at newline boundaries, parsed by one worker
+typedef struct {
+    const char* start;
+    const char* end;
+    int first_line; // line number of the first line in the chunk
+    int line_count;
+    int row_base;   // first slot in processes this chunk may fill
+    int row_count;  // rows actually parsed (blank and bad lines are skipped)
+    int error_count;
+    int error_lines[MAX_PARSE_ERRORS];
+    const char* error_msgs[MAX_PARSE_ERRORS];
+} ParseChunk;
+
+// Work shared by the parse workers. Each phase hands chunks out through
+// next_chunk until they run out.
+typedef struct {
+    ParseChunk* chunks;
+    int chunk_count;
+    int next_chunk;
+    int phase;          // PARSE_COUNT_LINES or PARSE_ROWS
+    ProcessTable table; // the loading thread's, the rows are parsed into it
+} ParseJob;
+
+enum { PARSE_COUNT_LINES, PARSE_ROWS };
+
+// Binary workload format (version 1), written by `schedsim convert`:
+//
+//   WorkloadHeader
+//   WorkloadColumn[column_count]
+//   column arrays, each 8-byte aligned, at the offsets the column table gives
+//
+// Fixed columns are "pid_id" (u32), "arrival", "burst" and "priority" (i32),
+// one element per row. "deadline" (i32, absolute, INT_MAX for none) is
+// optional. PID names live in "pid_name_offsets" (u64, one more
+// element than there are names) indexing into "pid_name_bytes" (u8). Loaders
+// look columns up by name and skip ones they do not know, so columns can be
+// added without a version bump. Values are stored in host byte order.
+#define WORKLOAD_MAGIC "SCHDWKLD"
+#define WORKLOAD_VERSION 1
+#define WORKLOAD_BYTE_ORDER 0x01020304u
+#define WORKLOAD_COLUMN_NAME 16
+
+typedef enum {
+    COLUMN_U8,
+    COLUMN_U32,
+    COLUMN_I32,
+    COLUMN_U64
+} WorkloadColumnType;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t row_count;
+    uint32_t column_count;
+    uint32_t reserved;
+} WorkloadHeader;
+
+typedef struct {
+    char name[WORKLOAD_COLUMN_NAME];
+    uint32_t type;
+    uint32_t width;   // bytes per element
+    uint64_t count;   // number of elements
+    uint64_t offset;  // from the start of the file
+} WorkloadColumn;
+
+// Ready queue implementations
+typedef enum {
+    QUEUE_RING, // FIFO ring buffer (FCFS, RR)
+    QUEUE_FLAT, // key array in enqueue order, SIMD argmin scan (short SJF/PRIORITY queues)
+    QUEUE_HEAP  // indexed binary min-heap on (key, seq) (long SJF/PRIORITY queues)
+} ReadyQueueKind;
+
+// Heap entries carry their key so sifting never has to go back to the
+// process table
+typedef struct {
+    int key;
+    int process;
+    uint64_t seq; // enqueue order, breaks key ties FIFO
+} HeapEntry;
+
+// Ready queue of process numbers. The ring keeps arrival order. Keyed
+// queues (SJF, PRIORITY) pick the smallest key and the earliest enqueued
+// process among equals, which is the same pick the old linear scan made.
+// They start out flat, where a vectorized scan over a contiguous key array
+// beats the heap's pointer chasing, and turn into a heap once they grow
+// past queue_crossover (and back once they shrink below half of it).
+typedef struct {
+    ReadyQueueKind kind;
+    int* ring;
+    HeapEntry* heap;
+    int* flat_keys;       // flat form, parallel arrays in enqueue order
+    int* flat_procs;
+    uint64_t* flat_seqs;
+    int flat_capacity;
+    int flat_hint;        // index of the last pick, usually the next dequeue
+    int flat_best;        // smallest key in the flat form, valid when flat_best_valid
+    int flat_best_valid;
+    int capacity;
+    int head;  // ring only
+    int count;
+    uint64_t next_seq;
+} ReadyQueue;
+
+// CFS run queue node, one per process. Nodes are linked by process number
+// (-1 for none) into a red-black tree ordered by (vruntime, seq).
+typedef struct {
+    uint64_t vruntime; // weighted run time, 1/1024 of a nice-0 time unit
+    uint64_t seq;      // insertion order, breaks vruntime ties FIFO
+    uint32_t weight;   // load weight from the nice value
+    int left;
+    int right;
+    int parent;
+    uint8_t red;
+} CfsNode;
+
+typedef struct {
+    CfsNode* nodes;
+    int root;
+    int leftmost;          // cached smallest node, the next pick
+    int count;             // runnable processes in the tree
+    uint64_t total_weight; // tree plus the running process
+    uint64_t min_vruntime; // never goes backwards, new arrivals start here
+    uint64_t next_seq;
+    int slice_left;        // units left in the running process's slice
+} CfsRunQueue;
+
+// MLFQ run lists: one FIFO per level, linked through next[] by process
+// number, with a bit per non-empty level. Level 0 is the highest.
+typedef struct {
+    int head[MLFQ_MAX_LEVELS];
+    int tail[MLFQ_MAX_LEVELS];
+    uint64_t nonempty;    // bit i set when level i has a process
+    int* next;            // per process, -1 ends a list
+    int* level;           // per process, valid when epoch matches boost_epoch
+    int* allotment;       // per process, quantum left at its level
+    uint32_t* epoch;      // per process, boost_epoch when level was last set
+    uint32_t boost_epoch; // bumped by every priority boost
+    int next_boost;       // time of the next boost
+    int running;
+} MlfqState;
+
+// Lottery draw pool: a Fenwick tree over the tickets of the waiting
+// processes, indexed by process number, so adding, removing and finding the
+// holder of the k-th ticket are all O(log n). A streaming run reuses slots
+// out of row order, so it keeps the tickets in a treap keyed by input row
+// instead, which puts them in the same order as the table of a normal run
+// and so draws the same winners. Per-CPU pools use the treap too, keyed by
+// process number: a process waits in one pool at a time, so the pools share
+// its nodes where each would need a whole Fenwick tree.
+typedef struct {
+    uint64_t* tree;  // 1-based, tree[i] sums the tickets of a range ending at i - 1
+    int size;
+    int top_bit;     // largest power of two <= size, where a draw starts
+    uint64_t total;  // tickets in the pool
+    uint64_t rng;    // splitmix64 state, from --seed (and the CPU)
+    // treap, streaming or per-CPU
+    int use_treap;
+    int* left;       // per process, treap children, -1 for none
+    int* right;
+    uint64_t* sum;   // per process, tickets of its subtree
+    int root;
+} LotteryPool;
+
+// Stride entry, carries its pass so sifting never leaves the heap
+typedef struct {
+    uint64_t pass;
+    uint64_t seq; // enqueue order, breaks pass ties FIFO
+    int process;
+} StrideEntry;
+
+// Stride scheduling: a min-heap on pass value. Processes only leave it by
+// being picked, so it needs no index.
+typedef struct {
+    StrideEntry* heap;
+    int count;
+    int capacity;
+    uint64_t* pass;    // per process
+    uint64_t min_pass; // never goes backwards, new arrivals start here
+    uint64_t next_seq;
+} StrideState;
 
 // gantt chart entry
 typedef struct {
-    char pid[32];
+    uint32_t pid_id; // GANTT_IDLE for idle time
     int start;
     int end;
 } GanttEntry;
 
-// process management
-Process *processes = NULL;
+// One Gantt timeline, the chart or a CPU's lane. A segment that carries
+// on the one before it (same process, no gap) is merged into it, and idle
+// time between segments gets a segment of its own, so the timeline runs
+// from `origin` to `end` without holes. A plain lane keeps every segment
+// as a GanttEntry. A compact one (--gantt-compact) keeps all but the last
+// as bytes, see gantt_encode(), and the last in `open` where it can still
+// grow.
+typedef struct {
+    GanttEntry* entries; // plain
+    uint8_t* bytes;      // compact
+    size_t used;         // bytes written (compact)
+    size_t capacity;     // entries or bytes
+    int count;           // segments, `open` included
+    int origin;          // start of the first segment
+    int end;             // end of the last one
+    GanttEntry open;     // compact: the last segment
+    uint32_t encoded_pid; // compact: pid_id of the last encoded segment
+} GanttLane;
+
+// Walks a compact lane's segments in order
+typedef struct {
+    const GanttLane* lane;
+    size_t at;   // next byte
+    int index;   // next segment
+    int time;    // its start
+    uint32_t pid_id; // the one before it, for the delta
+} GanttCursor;
+
+// Everything the policy hooks work on. The hooks use the globals below.
+// With several CPUs each CPU keeps its own copy and it is swapped in
+// around that CPU's hook calls, so the single CPU path pays nothing.
+typedef struct {
+    ReadyQueue ready_queue;
+    CfsRunQueue cfs;
+    MlfqState mlfq;
+    LotteryPool lottery;
+    StrideState stride;
+    int rr_quantum_left;
+} PolicyState;
+
+// One simulated CPU. With BALANCE_STEAL `policy` is its own run queue,
+// with BALANCE_GLOBAL only the fields describing the running dispatch
+// (quantum and slice left, MLFQ's running process) are its own.
+typedef struct {
+    PolicyState policy;
+    int running;         // process on the CPU, -1 when idle
+    int execution_start; // start of the running Gantt segment
+    int slice_end;       // end of the running slice, the CPU's next event
+    int waiting;         // processes in its run queue (BALANCE_STEAL)
+    long long busy;      // units spent running
+    int migrations;      // dispatches of a process that last ran on another CPU
+    GanttLane gantt;     // this CPU's Gantt lane
+    int last_finish;     // time the last process finished here
+} Cpu;
+
+// The per-thread run state a helper thread needs to work on another
+// thread's run: the process table and CPUs, and the parameters under test
+typedef struct {
+    ProcessTable processes;
+    Cpu* cpus;
+    int* last_cpu;
+    SchedulingAlgorithm algorithm;
+    int time_quantum;
+    int mlfq_quanta[MLFQ_MAX_LEVELS];
+} RunState;
+
+// The epoch all host threads are working on. Thread 0 fills it in between
+// the two barriers, the others only read it.
+typedef struct {
+    RunState run;     // thread 0's, adopted by the others
+    const SchedulingPolicy* policy;
+    int start;        // time the epoch starts
+    int horizon;      // next cross-core event, where the epoch ends
+    int next_arrival; // slices are still cut at it
+    int hosts;        // host threads, host_threads[0] is the main thread
+    int done;
+    pthread_barrier_t begin;
+    pthread_barrier_t end;
+} Epoch;
+
+// Per-process metrics kept as histograms
+enum { METRIC_WAIT, METRIC_RESP, METRIC_TURN, METRIC_COUNT };
+
+// Log-linear histogram of non-negative ints, see hist_record()
+typedef struct {
+    uint64_t count;
+    int64_t sum; // exact, for the mean
+    int max;
+    uint64_t buckets[HIST_BUCKETS];
+} Histogram;
+
+// What a run measures, recorded as each process finishes
+typedef struct {
+    Histogram metric[METRIC_COUNT];
+    int deadline_count;
+    int deadline_misses;
+} RunMetrics;
+
+// A host thread advancing a fixed range of CPUs through each epoch
+typedef struct {
+    pthread_t thread;
+    Epoch* epoch;
+    int first_cpu;
+    int cpu_end;
+    int finished; // processes finished in the last epoch
+    Arena arena;  // its allocations (lanes, queues that grew), kept for printing
+    RunMetrics* metrics; // of the processes its CPUs finished, merged at the end
+} HostThread;
+
+// The averages print_results reports under the per-process table
+typedef struct {
+    float avg_wait;
+    float avg_resp;
+    float avg_turn;
+    float throughput;  // jobs per unit time
+    float utilization; // percent
+    int deadline_count;
+    int deadline_misses;
+    int p99[METRIC_COUNT];
+} RunSummary;
+
+// One algorithm and quantum combination of a parameter sweep
+typedef struct {
+    SchedulingAlgorithm algorithm;
+    int quantum; // -1 when the policy does not use one
+    RunSummary summary;
+} SweepRun;
+
+// Work shared by the sweep workers. Runs are handed out through next_run
+// until they run out, each worker simulating on its own per-run columns.
+typedef struct {
+    RunState input; // the loaded table, only its input columns are read
+    int gantt_capacity;
+    SweepRun* runs;
+    int run_count;
+    int next_run;
+} SweepJob;
+
+// Generated arrivals
+typedef enum {
+    ARRIVAL_POISSON, // exponential gaps
+    ARRIVAL_BURSTY   // Poisson clumps of processes arriving together
+} ArrivalModel;
+
+// Generated burst lengths
+typedef enum {
+    BURST_EXPONENTIAL,
+    BURST_PARETO,  // heavy tailed
+    BURST_BIMODAL  // a mix of short and long exponential bursts
+} BurstModel;
+
+#define MAX_PRIORITY_MIX 16
+
+// What the workload generator draws from
+typedef struct {
+    int processes;        // per workload
+    ArrivalModel arrivals;
+    double arrival_gap;   // mean time between arrivals
+    double clump;         // ARRIVAL_BURSTY: mean processes per clump
+    BurstModel bursts;
+    double burst;         // exponential and bimodal short mean, Pareto minimum
+    double burst_long;    // bimodal long mean
+    double long_share;    // bimodal share of long bursts
+    double pareto_shape;  // Pareto alpha
+    int priority_min;     // uniform over the range when mix_count is 0
+    int priority_max;
+    int mix_count;        // otherwise drawn from the mix
+    int mix_priority[MAX_PRIORITY_MIX];
+    double mix_weight[MAX_PRIORITY_MIX]; // running total
+} WorkloadSpec;
+
+// Draws one workload from a spec, a process at a time in arrival order
+typedef struct {
+    const WorkloadSpec* spec;
+    uint64_t rng;   // splitmix64 state
+    double clock;   // arrival of the last process, before rounding
+    int clump_left; // ARRIVAL_BURSTY: processes still to come at clock
+    int generated;
+} WorkloadGenerator;
+
+// A Monte Carlo worker's share of the workloads, [next, end). The owner
+// takes from the front, a thief takes the back half.
+typedef struct {
+    pthread_t thread;
+    struct MonteCarloJob* job;
+    int index;
+    pthread_mutex_t lock;
+    int next;
+    int end;
+    int steals; // shares this worker took from others
+    RunMetrics* pooled; // every workload it ran, merged
+} MonteCarloWorker;
+
+typedef struct MonteCarloJob {
+    RunState input; // the shared columns (PID ids), the rest is per workload
+    int gantt_capacity;
+    MonteCarloWorker* workers;
+    int worker_count;
+    RunSummary* results; // by workload number
+} MonteCarloJob;
+
+// Where a streaming run reads its rows from
+typedef enum {
+    STREAM_CSV,
+    STREAM_BINARY,
+    STREAM_GENERATED
+} StreamInput;
+
+// A streaming run (--stream). The input is read one row ahead of the clock
+// into a free slot of the process table, and a finished process has its
+// row printed and its slot put back, so the table only holds the processes
+// that are live. A slot is reused once the Gantt band holding its last
+// segment is written, the band names processes by slot.
+typedef struct {
+    StreamInput input;
+    const char* filename;
+    int next;                 // slot holding the row read ahead, -1 once the input is done
+    int last_arrival;         // of the row read before it, rows must come in arrival order
+    int live;                 // admitted and not finished
+    int peak_live;
+    int* free_slots;          // stack of free slots
+    int free_count;
+    int pending[GANTT_BAND];  // finished, held until their Gantt band is written
+    int pending_count;
+    int bands;                // Gantt bands written
+    PidSlice* names;          // per slot
+    uint64_t* row_of;         // per slot, the input row it holds
+    char* generated_names;    // per slot, STREAM_NAME bytes each
+    uint64_t rows;            // rows read so far
+    uint64_t released;        // CSV bytes or binary rows already dropped from memory
+    // CSV input
+    const char* at;           // start of the next line
+    int line;                 // its line number
+    // binary input, columns read in place from the mapping
+    uint64_t row_count;
+    uint64_t row_bytes;       // of the mapping, over all the columns
+    const uint32_t* pid_ids;
+    const int32_t* arrivals;
+    const int32_t* bursts;
+    const int32_t* priorities;
+    const int32_t* deadlines; // NULL when there is no deadline column
+    const uint64_t* name_offsets;
+    const char* name_bytes;
+    uint64_t name_count;
+    uint64_t name_bytes_count;
+    uint64_t released_name;   // names below this id already dropped from memory
+} StreamState;
+
+// Storage for everything sized by the input. Like the rest of the state the
+// policy hooks touch, it is per thread so host threads can run CPUs side by
+// side and sweep workers can run whole simulations side by side. The other
+// helper threads use the main thread's.
+__thread Arena arena;
+
+// the input file stays mapped for the whole run, PIDs point into it
+const char* input_map = NULL;
+size_t input_size = 0;
+
+// interned PID names
+PidTable pid_table;
+PidSlice* pid_slices = NULL; // per-row names while loading, before interning
+
+// process management. The table columns are per thread: a run works on
+// its own per-run columns over the shared input columns (see RunState).
+__thread ProcessTable processes;
+ProcessThread* process_threads = NULL; // threaded engine only
+RunState process_thread_run; // the scheduler's, adopted by the process threads
 int process_count = 0;
+int process_capacity = 0;
 
-// scheduling state
-SchedulingAlgorithm algorithm = FCFS; // default algorithm
-int time_quantum = 1; // default time quantum for RR
-int current_time = 0; 
+// scheduling state. The parameters a sweep varies are per thread.
+__thread SchedulingAlgorithm algorithm = FCFS; // default algorithm
+__thread int time_quantum = 1; // default time quantum for RR
+ExecutionEngine engine = ENGINE_DIRECT; // default engine
+int queue_crossover = QUEUE_CROSSOVER;
+int cfs_latency = CFS_LATENCY;
+int cfs_min_granularity = CFS_MIN_GRANULARITY;
+int mlfq_levels = MLFQ_LEVELS;
+__thread int mlfq_quanta[MLFQ_MAX_LEVELS]; // 0 = twice the level above, -q for level 0
+int mlfq_boost = MLFQ_BOOST;      // 0 = never boost
+uint64_t seed = 1;                // lottery draws
+int cpu_count = 1;
+BalanceMode balance = BALANCE_GLOBAL;
+int balance_interval = BALANCE_INTERVAL;
+int host_thread_count = 1; // host threads for --balance steal
+int parse_threads = 0; // 0 = one per online core
+SchedulingAlgorithm sweep_algorithms[STRIDE + 1]; // --sweep list, in the order given
+int sweep_count = 0;
+int sweep_quantum_first = 0; // --sweep-quanta range, 0 = just -q
+int sweep_quantum_last = 0;
+int sweep_quantum_step = 1;
+int sweep_threads = 0; // 0 = one per online core
+int input_generated = 0; // the input comes from --workload instead of -i
+int input_lazy = 0;      // and each row is generated when the one before it arrives
+WorkloadGenerator input_generator;
+int monte_carlo_runs = 0;    // --monte-carlo, workloads to generate
+int monte_carlo_threads = 0; // 0 = one per online core
+WorkloadSpec workload_spec = {
+    .processes = 1000, .arrivals = ARRIVAL_POISSON, .arrival_gap = 5.0,
+    .bursts = BURST_EXPONENTIAL, .burst = 4.0, .priority_min = 1, .priority_max = 10,
+};
+int show_stats = 0;    // print load statistics to stderr
+int stream_mode = 0;   // --stream, only the live processes are held
+StreamState stream;
+FILE* gantt_file = NULL; // --gantt, NULL = stdout (a streaming run leaves the chart out)
+int has_deadlines = 0; // the input has a deadline column
+int deadline_column = -1; // CSV column holding the deadline, -1 if none
+__thread int current_time = 0; 
+
+// Arrival order: indices into processes sorted by arrival, stable on CSV
+// order. The scheduler admits arrivals by advancing a cursor through it.
+// Generated input is already in arrival order and has none (NULL).
+int* arrival_order = NULL;
+__thread int arrival_cursor = 0;
 
 // Ready queue
-Process* ready_queue[MAX_PROCESSES];
-int ready_count = 0;
+__thread int run_queue_capacity = 0; // entries a run queue starts with, 0 = one per process
+__thread int policy_instance = 0;    // run queue being set up, later ones share the per-process columns
+__thread ReadyQueue ready_queue;
+__thread CfsRunQueue cfs; // CFS uses this instead of ready_queue
+__thread MlfqState mlfq;  // so does MLFQ
+__thread LotteryPool lottery; // and lottery
+__thread StrideState stride;  // and stride
 
 // gantt chart
-GanttEntry gantt_chart[MAX_PROCESSES * 100];
-int gantt_count = 0;
+__thread GanttLane gantt_chart;
+__thread int gantt_capacity = 0; // segments to reserve for a run's chart
+__thread int gantt_recording = 1; // 0 for runs whose chart is never printed
+int gantt_compact = 0; // --gantt-compact
+
+// simulated CPUs, only used with --cpus above 1
+__thread Cpu* cpus = NULL;
+__thread int* last_cpu = NULL; // per process, CPU it last ran on, -1 before its first run
+__thread HostThread* host_threads = NULL;
+__thread int host_threads_used = 0; // entries in host_threads
 
 // synchronization
 sem_t scheduler_sem; // global semaphore for scheduler to signal processes
 pthread_mutex_t scheduler_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 // global utilization
-float cpu_utilization = 0.0;
+__thread float cpu_utilization = 0.0;
+
+// the running simulation's histograms, see record_completion()
+__thread RunMetrics* run_metrics = NULL;
 
 // Function prototypes
 
 // initialaization and cleanup
-void initialize_scheduler(void);
+void initialize_scheduler(const char* filename);
 void cleanup_scheduler(void);
 
-// Parsing
+// Arena
+void arena_init(Arena* a, size_t size);
+void* arena_alloc(Arena* a, size_t size);
+void* arena_grow(Arena* a, void* old, size_t old_size, size_t new_size);
+void arena_free_all(Arena* a);
+void arena_reset(Arena* a);
+void release_pages(const void* from, const void* to);
+
+// Loading
+void load_workload(const char* filename);
+void map_input(const char* filename);
 void parse_file(const char* filename);
+void load_binary(const char* filename);
+void build_arrival_order(void);
+void reserve_processes(int capacity);
+void reset_processes(void);
+void run_parse_phase(ParseJob* job, int phase, int threads);
+void *parse_worker(void *arg);
 
 // Thread management
 void spawn_threads(void);
 void wait_threads(void);
 void *process_thread(void *arg);
+void execute_process(int process, int start, int units);
+void save_run_state(RunState* state);
+void adopt_run_state(const RunState* state);
+
+// Latency histograms
+void hist_record(Histogram* hist, int value);
+void hist_merge(Histogram* into, const Histogram* from);
+int hist_percentile(const Histogram* hist, double q);
+RunMetrics* new_run_metrics(void);
+void merge_run_metrics(RunMetrics* into, const RunMetrics* from);
+void record_completion(int process);
+
+// Gantt chart
+void gantt_lane_init(GanttLane* lane, int segments);
+void gantt_append(GanttLane* lane, uint32_t pid_id, int start, int end);
+void add_gantt_entry(int process, int start, int end);
+void gantt_cursor_init(GanttCursor* cursor, const GanttLane* lane);
+int gantt_cursor_next(GanttCursor* cursor, GanttEntry* entry);
+size_t gantt_lane_bytes(const GanttLane* lane);
+
+// Argmin kernels
+void init_argmin_kernel(void);
+int argmin_scalar(const int* keys, int count);
 
 // Queue Operations
-void enqueue_process(Process* process);
-void dequeue_process(Process* process);
+void init_ready_queue(ReadyQueueKind kind);
+void enqueue_process(int process, int key);
+void dequeue_process(int process);
+int ready_queue_at(int i);
 
 // Scheduling
 void run_scheduler();
-Process* select_next_process();
+void run_multicore(void);
+int parse_sweep_list(const char* list);
+int parse_quantum_range(const char* range);
+void run_sweep(void);
+int parse_workload_spec(const char* spec);
+void generator_init(WorkloadGenerator* gen, const WorkloadSpec* spec, uint64_t rng);
+int generator_next(WorkloadGenerator* gen, int* arrival, int* burst, int* priority);
+void load_generated(void);
+void generate_row(int row);
+void grow_generated(void);
+int run_generate(int argc, char* argv[]);
+void run_monte_carlo(void);
+void load_stream(const char* filename);
+void stream_read(void);
+void retire_process(int process);
+void flush_gantt_band(void);
+int select_next_process();
+int ready_queue_best_key(void);
+int next_arrival_time(void);
+
+// PID interning
+void init_pid_table(uint32_t expected);
+uint32_t intern_pid(const char* name, uint32_t len, uint32_t hash);
+const char* pid_name(uint32_t id, int* len);
+
+// Converting and benchmarking
+int run_convert(int argc, char* argv[]);
+int run_bench_queue(int argc, char* argv[]);
+void write_binary_workload(const char* filename);
 
 // Printing
 void print_results();
-void print_gantt_chart();
+void print_results_header(void);
+void print_result_row(int process);
+void summarize_run(RunSummary* summary);
+void print_sweep(const SweepRun* runs, int count);
+void print_monte_carlo(const RunSummary* results, int count, const RunMetrics* pooled);
+void print_percentiles(const RunMetrics* metrics);
+void print_gantt_chart(FILE* out, const char* title, const GanttEntry* entries, int count);
+void print_gantt_lane(FILE* out, const char* title, const GanttLane* lane);
 static void print_usage(const char *progname);
 
+// A whole decimal number of at least `min`, 0 for anything else
+static int parse_int_option(const char* text, int min, int* value) {
+    char* end;
+    long n = strtol(text, &end, 10); // out of range saturates, past INT_MAX
+    if (end == text || *end != '\0' || n < min || n > INT_MAX) {
+        return 0;
+    }
+    *value = (int)n;
+    return 1;
+}
+
 int main(int argc, char* argv[]) {
     char* filename = NULL;
     int algo_set = 0;
+    int workload_set = 0;
     
+    init_argmin_kernel();
+    if (argc > 1 && strcmp(argv[1], "convert") == 0) {
+        return run_convert(argc - 1, argv + 1);
+    }
+    if (argc > 1 && strcmp(argv[1], "bench-queue") == 0) {
+        return run_bench_queue(argc - 1, argv + 1);
+    }
+    if (argc > 1 && strcmp(argv[1], "generate") == 0) {
+        return run_generate(argc - 1, argv + 1);
+    }
 
     static struct option long_opts[] = {
         {"fcfs", no_argument, 0, 'f'},
         {"sjf", no_argument, 0, 's'},
         {"rr", no_argument, 0, 'r'},
         {"priority", no_argument, 0, 'p'},
+        {"srtf", no_argument, 0, 't'},
+        {"cfs", no_argument, 0, 'C'},
+        {"cfs-latency", required_argument, 0, 'L'},
+        {"cfs-min-granularity", required_argument, 0, 'G'},
+        {"mlfq", no_argument, 0, 'M'},
+        {"mlfq-levels", required_argument, 0, 'l'},
+        {"mlfq-quanta", required_argument, 0, 'Q'},
+        {"mlfq-boost", required_argument, 0, 'B'},
+        {"edf", no_argument, 0, 'D'},
+        {"lottery", no_argument, 0, 'y'},
+        {"stride", no_argument, 0, 'Z'},
+        {"seed", required_argument, 0, 'R'},
+        {"cpus", required_argument, 0, 'c'},
+        {"balance", required_argument, 0, 'b'},
+        {"balance-interval", required_argument, 0, 'I'},
+        {"host-threads", required_argument, 0, 'H'},
+        {"sweep", required_argument, 0, 'W'},
+        {"sweep-quanta", required_argument, 0, 'K'},
+        {"sweep-threads", required_argument, 0, 'J'},
+        {"monte-carlo", required_argument, 0, 'm'},
+        {"monte-carlo-threads", required_argument, 0, 'j'},
+        {"workload", required_argument, 0, 'w'},
+        {"stream", no_argument, 0, 'u'},
+        {"gantt", required_argument, 0, 'g'},
+        {"gantt-compact", no_argument, 0, 'z'},
         {"input", required_argument, 0, 'i'},
         {"quantum", required_argument, 0, 'q'},
+        {"engine", required_argument, 0, 'e'},
+        {"parse-threads", required_argument, 0, 'T'},
+        {"stats", no_argument, 0, 'S'},
+        {"queue-crossover", required_argument, 0, 'X'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "fsrpi:q:h", long_opts, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "fsrpti:q:e:h", long_opts, NULL)) != -1) {
         switch (opt) {
             case 'f': 
                 algorithm = FCFS; 
@@ -146,39 +898,290 @@ int main(int argc, char* argv[]) {
                 algorithm = PRIORITY; 
                 algo_set = 1; 
                 break;
+            case 't':
+                algorithm = SRTF;
+                algo_set = 1;
+                break;
+            case 'C':
+                algorithm = CFS;
+                algo_set = 1;
+                break;
+            case 'L':
+                if (!parse_int_option(optarg, 1, &cfs_latency)) {
+                    fprintf(stderr, "Error: --cfs-latency must be positive.\n");
+                    exit(1);
+                }
+                break;
+            case 'G':
+                if (!parse_int_option(optarg, 0, &cfs_min_granularity)) {
+                    fprintf(stderr, "Error: --cfs-min-granularity must not be negative.\n");
+                    exit(1);
+                }
+                break;
+            case 'M':
+                algorithm = MLFQ;
+                algo_set = 1;
+                break;
+            case 'l':
+                mlfq_levels = atoi(optarg);
+                if (mlfq_levels < 1 || mlfq_levels > MLFQ_MAX_LEVELS) {
+                    fprintf(stderr, "Error: --mlfq-levels must be between 1 and %d.\n", MLFQ_MAX_LEVELS);
+                    exit(1);
+                }
+                break;
+            case 'Q': {
+                // comma separated, one quantum per level from the top
+                char* at = optarg;
+                for (int level = 0; level < MLFQ_MAX_LEVELS && *at != '\0'; level++) {
+                    char* end;
+                    long quantum = strtol(at, &end, 10);
+                    if (end == at || quantum < 1 || quantum > INT_MAX || (*end != ',' && *end != '\0')) {
+                        fprintf(stderr, "Error: bad --mlfq-quanta '%s'.\n", optarg);
+                        exit(1);
+                    }
+                    mlfq_quanta[level] = (int)quantum;
+                    at = *end == ',' ? end + 1 : end;
+                }
+                break;
+            }
+            case 'B':
+                if (!parse_int_option(optarg, 0, &mlfq_boost)) {
+                    fprintf(stderr, "Error: bad --mlfq-boost '%s', use 0 (never) or a positive interval.\n\n", optarg);
+                    print_usage(argv[0]);
+                    exit(1);
+                }
+                break;
+            case 'D':
+                algorithm = EDF;
+                algo_set = 1;
+                break;
+            case 'y':
+                algorithm = LOTTERY;
+                algo_set = 1;
+                break;
+            case 'Z':
+                algorithm = STRIDE;
+                algo_set = 1;
+                break;
+            case 'R':
+                seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'c':
+                cpu_count = atoi(optarg);
+                if (cpu_count < 1 || cpu_count > MAX_CPUS) {
+                    fprintf(stderr, "Error: --cpus must be between 1 and %d.\n", MAX_CPUS);
+                    exit(1);
+                }
+                break;
+            case 'b':
+                if (strcmp(optarg, "global") == 0) {
+                    balance = BALANCE_GLOBAL;
+                } else if (strcmp(optarg, "steal") == 0) {
+                    balance = BALANCE_STEAL;
+                } else {
+                    fprintf(stderr, "Error: unknown balance mode '%s'.\n\n", optarg);
+                    print_usage(argv[0]);
+                    exit(1);
+                }
+                break;
+            case 'H':
+                if (!parse_int_option(optarg, 0, &host_thread_count)) {
+                    fprintf(stderr, "Error: --host-threads must be 0 (one per core) or positive.\n");
+                    exit(1);
+                }
+                if (host_thread_count == 0) {
+                    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+                    host_thread_count = cores > 0 ? (int)cores : 1;
+                }
+                break;
+            case 'I':
+                balance_interval = atoi(optarg);
+                if (balance_interval < 1) {
+                    fprintf(stderr, "Error: --balance-interval must be positive.\n");
+                    exit(1);
+                }
+                break;
+            case 'W':
+                if (!parse_sweep_list(optarg)) {
+                    fprintf(stderr, "Error: bad --sweep '%s'.\n\n", optarg);
+                    print_usage(argv[0]);
+                    exit(1);
+                }
+                break;
+            case 'K':
+                if (!parse_quantum_range(optarg)) {
+                    fprintf(stderr, "Error: bad --sweep-quanta '%s'.\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'J':
+                if (!parse_int_option(optarg, 0, &sweep_threads)) {
+                    fprintf(stderr, "Error: --sweep-threads must be 0 (one per core) or positive.\n");
+                    exit(1);
+                }
+                break;
+            case 'm':
+                monte_carlo_runs = atoi(optarg);
+                if (monte_carlo_runs < 1) {
+                    fprintf(stderr, "Error: --monte-carlo must be positive.\n");
+                    exit(1);
+                }
+                break;
+            case 'j':
+                monte_carlo_threads = atoi(optarg);
+                break;
+            case 'w':
+                if (!parse_workload_spec(optarg)) {
+                    fprintf(stderr, "Error: bad --workload '%s'.\n\n", optarg);
+                    print_usage(argv[0]);
+                    exit(1);
+                }
+                workload_set = 1;
+                break;
+            case 'u':
+                stream_mode = 1;
+                break;
+            case 'g':
+                gantt_file = fopen(optarg, "w");
+                if (gantt_file == NULL) {
+                    perror("Error opening Gantt file");
+                    exit(1);
+                }
+                break;
+            case 'z':
+                gantt_compact = 1;
+                break;
             case 'i': 
                 filename = optarg; 
                 break;
             case 'q': 
                 time_quantum = atoi(optarg); 
+                if (time_quantum < 1) {
+                    fprintf(stderr, "Error: --quantum must be positive.\n");
+                    exit(1);
+                }
+                break;
+            case 'T':
+                if (!parse_int_option(optarg, 0, &parse_threads)) {
+                    fprintf(stderr, "Error: --parse-threads must be 0 (one per core) or positive.\n");
+                    exit(1);
+                }
+                break;
+            case 'S':
+                show_stats = 1;
+                break;
+            case 'X':
+                if (!parse_int_option(optarg, 0, &queue_crossover)) {
+                    fprintf(stderr, "Error: --queue-crossover must not be negative (0 = always a heap).\n");
+                    exit(1);
+                }
+                break;
+            case 'e':
+                if (strcmp(optarg, "direct") == 0) {
+                    engine = ENGINE_DIRECT;
+                } else if (strcmp(optarg, "threaded") == 0) {
+                    engine = ENGINE_THREADED;
+                } else {
+                    fprintf(stderr, "Error: unknown engine '%s'.\n\n", optarg);
+                    print_usage(argv[0]);
+                    sem_destroy(&scheduler_sem);
+                    exit(1);
+                }
                 break;
             case 'h': // If the user needs help, print it, but then clean up
                 print_usage(argv[0]);
-                free(processes);
                 sem_destroy(&scheduler_sem);
                 exit(0);
             default:
                 print_usage(argv[0]);
-                free(processes);
                 sem_destroy(&scheduler_sem);
                 exit(1);
         }
     }
 
-    if (!algo_set || !filename) {
-        fprintf(stderr, "Error: must specify algorithm and input file.\n\n");
+    if (cfs_min_granularity > cfs_latency) {
+        fprintf(stderr, "Error: --cfs-min-granularity must not be above --cfs-latency.\n");
+        return 1;
+    }
+
+    if (algorithm == EDF && (monte_carlo_runs > 0 || workload_set)) {
+        fprintf(stderr, "Error: --edf needs deadlines, generated workloads have none.\n");
+        return 1;
+    }
+
+    if (monte_carlo_runs > 0) {
+        // the workloads are generated, there is no input to load
+        if (!algo_set || filename || sweep_count > 0 || stream_mode || engine == ENGINE_THREADED) {
+            fprintf(stderr, "Error: --monte-carlo needs an algorithm, the direct engine and no input file, sweep or stream.\n");
+            return 1;
+        }
+        arena_init(&arena, ARENA_MIN_BLOCK);
+        run_monte_carlo();
+        arena_free_all(&arena);
+        return 0;
+    }
+    if (filename && workload_set) {
+        fprintf(stderr, "Error: --workload generates the input, it cannot be used with -i.\n");
+        return 1;
+    }
+    input_generated = workload_set;
+    if ((!algo_set && sweep_count == 0) || (!filename && !input_generated)) {
+        fprintf(stderr, "Error: must specify algorithm and input file (or --workload).\n\n");
         print_usage(argv[0]);
-        free(processes);
         sem_destroy(&scheduler_sem);
         return 1;
     }
+    if (cpu_count > 1 && engine == ENGINE_THREADED) {
+        fprintf(stderr, "Error: --cpus above 1 needs the direct engine.\n");
+        return 1;
+    }
+    if (sweep_count > 0 && engine == ENGINE_THREADED) {
+        fprintf(stderr, "Error: --sweep needs the direct engine.\n");
+        return 1;
+    }
+    if (stream_mode && (cpu_count > 1 || sweep_count > 0 || engine == ENGINE_THREADED)) {
+        fprintf(stderr, "Error: --stream needs one CPU, the direct engine and no sweep.\n");
+        return 1;
+    }
+    if (stream_mode && gantt_compact) {
+        fprintf(stderr, "Error: --gantt-compact cannot be used with --stream, which keeps one band.\n");
+        return 1;
+    }
+
+    // Generated rows are made as the clock reaches them, unless they are
+    // needed up front: a sweep shares them, process threads need their work
+    // before they start and the per-CPU policy states cannot grow
+    input_lazy = input_generated && !stream_mode && sweep_count == 0 &&
+                 engine == ENGINE_DIRECT && cpu_count == 1;
 
     // Initialize and run scheduler
-    initialize_scheduler();
-    parse_file(filename);
-    spawn_threads();
+    initialize_scheduler(filename);
+    if (stream_mode) {
+        load_stream(filename);
+    } else if (input_generated) {
+        load_generated();
+    } else {
+        load_workload(filename);
+    }
+    if (algorithm == EDF && sweep_count == 0 && !has_deadlines) {
+        fprintf(stderr, "Error: --edf needs a deadline column in %s.\n", filename);
+        exit(1);
+    }
+    if (sweep_count > 0) {
+        run_sweep();
+        cleanup_scheduler();
+        return 0;
+    }
+    if (engine == ENGINE_THREADED) {
+        spawn_threads();
+    }
+    if (stream_mode) {
+        print_results_header(); // the rows follow as the processes finish
+    }
     run_scheduler();
-    wait_threads();
+    if (engine == ENGINE_THREADED) {
+        wait_threads();
+    }
     print_results();
     cleanup_scheduler();
 
@@ -186,402 +1189,4702 @@ int main(int argc, char* argv[]) {
 }
 
 // initialaization and cleanup
-void initialize_scheduler(void) {
-    processes = malloc(sizeof(Process) * MAX_PROCESSES);
-    if (processes == NULL) {
-        perror("Failed to allocate memory for processes");
-        exit(1);
+void initialize_scheduler(const char* filename) {
+    // Size the arena from the file length so a large trace loads with a
+    // handful of allocations. The tables still grow if the estimate is low.
+    // Generated input (no file) has exactly the spec's processes, but the
+    // table only grows to them as they arrive when generated lazily.
+    // A streaming run holds only the live processes.
+    size_t rows = (size_t)workload_spec.processes + 1;
+    if (stream_mode) {
+        rows = STREAM_SLOTS;
+    } else if (input_lazy) {
+        rows = GENERATED_ROWS;
+    } else if (filename != NULL) {
+        struct stat st;
+        if (stat(filename, &st) != 0) {
+            perror("Error opening file");
+            exit(1);
+        }
+        rows = st.st_size / EST_ROW_BYTES + 1;
     }
+    gantt_capacity = rows * GANTT_PER_PROCESS;
+    size_t per_process = 8 * sizeof(int) + sizeof(uint8_t) + sizeof(uint32_t) + // process table
+                         sizeof(int) + sizeof(HeapEntry) +                      // arrival order, queue
+                         GANTT_PER_PROCESS * sizeof(GanttEntry);
+    arena_init(&arena, rows * per_process + 16 * ARENA_ALIGN);
     sem_init(&scheduler_sem, 0, 0);
 }
 
 void cleanup_scheduler(void) {
     sem_destroy(&scheduler_sem);
     pthread_mutex_destroy(&scheduler_mutex);
-    free(processes);
+    for (int k = 1; host_threads != NULL && k < host_threads_used; k++) {
+        arena_free_all(&host_threads[k].arena);
+    }
+    host_threads = NULL;
+    host_threads_used = 0;
+    arena_free_all(&arena);
+    if (input_map != NULL) {
+        munmap((void*)input_map, input_size);
+        input_map = NULL;
+    }
+    memset(&processes, 0, sizeof(processes));
+    process_capacity = 0;
+    memset(&gantt_chart, 0, sizeof(gantt_chart));
+    if (gantt_file != NULL) {
+        fclose(gantt_file);
+        gantt_file = NULL;
+    }
 }
 
-// file parsing
-void parse_file(const char* filename) {
-    FILE *file = fopen(filename, "r");
-    if (file == NULL) {
-        perror("Error opening file.\n");
+// arena
+static ArenaBlock* arena_new_block(size_t size) {
+    if (size < ARENA_MIN_BLOCK) {
+        size = ARENA_MIN_BLOCK;
+    }
+    ArenaBlock* block = malloc(sizeof(ArenaBlock) + size);
+    if (block == NULL) {
+        perror("Failed to allocate memory");
+        exit(1);
     }
-    char line[BUFFER_SIZE]; // buffer to store each line
-    int lineNum = 0;
-    while (fgets(line, sizeof(line), file) != NULL) {
-        line[strcspn(line, "\n")] = 0;
+    block->size = size;
+    block->used = 0;
+    block->next = NULL;
+    return block;
+}
 
-        if (lineNum == 0) { // Skipping first line
-            lineNum++;
-            continue;
-        }
+void arena_init(Arena* a, size_t size) {
+    a->head = arena_new_block(size);
+    a->last = NULL;
+    a->last_size = 0;
+}
 
-        char* token = strtok(line, ",");
-        int column = 0;
-        Process* process = &processes[process_count];
-        while (token != NULL) {
-            
-            switch (column) {
-                case 0: // PID
-                    strcpy(process->pid, token);
-                    break;
-                case 1: // Arrival Time
-                    process->arrival = atoi(token);
-                    break;
-                case 2: // Burst Time
-                    process->burst = atoi(token);
-                    break;
-                case 3: // Priority
-                    process->priority = atoi(token);
-                    break;
-            }
-            token = strtok(NULL, ",");
-            column++;
-        }
-        process->remaining_time = process->burst;
-        process->start_time = -1;
-        process->finish_time = 0;
-        process->waiting_time = 0;
-        process->response_time = -1;
-        process->turnaround_time = 0;
-        process->in_ready_queue = 0;
-        process->finished = 0;
-        process->started = 0;
-        sem_init(&process->semaphore, 0, 0); // Initialize semaphore
-        process_count++;
-        lineNum++;
+void* arena_alloc(Arena* a, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    ArenaBlock* block = a->head;
+    if (block->size - block->used < size) {
+        // start a new block at least as big as everything so far
+        block = arena_new_block(size > block->size * 2 ? size : block->size * 2);
+        block->next = a->head;
+        a->head = block;
     }
-    fclose(file);
+    void* p = block->data + block->used;
+    block->used += size;
+    a->last = p;
+    a->last_size = size;
+    return p;
 }
 
-void spawn_threads() {
-    for (int i = 0; i < process_count; i++) {
-        pthread_create(&processes[i].thread, NULL, process_thread, (void*)&processes[i]);
+// Drop the whole pages of [from, to) from memory. Pages of the mapped input
+// are clean, so reading them again (a live process's name) just faults them
+// back in. Arena pages read back as zeros.
+void release_pages(const void* from, const void* to) {
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = ((uintptr_t)from + page - 1) & ~(page - 1);
+    uintptr_t end = (uintptr_t)to & ~(page - 1);
+    if (end > start) {
+        madvise((void*)start, end - start, MADV_DONTNEED);
     }
 }
 
-void wait_threads() {
-    for (int i = 0; i < process_count; i++) {
-        pthread_join(processes[i].thread, NULL); // Join the thread
-        sem_destroy(&processes[i].semaphore); // Also destroy the semaphore
+// Grow an allocation. The most recent allocation is extended in place when
+// its block has room, anything else is copied to a fresh allocation. The
+// old copy is dead then, so a large one gives its pages back; a table that
+// keeps doubling would otherwise leave as much again behind it.
+void* arena_grow(Arena* a, void* old, size_t old_size, size_t new_size) {
+    ArenaBlock* block = a->head;
+    if (old != NULL && old == a->last) {
+        size_t base = (char*)old - block->data;
+        size_t size = (new_size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+        if (block->size - base >= size) {
+            block->used = base + size;
+            a->last_size = size;
+            return old;
+        }
+    }
+    void* p = arena_alloc(a, new_size);
+    if (old != NULL) {
+        memcpy(p, old, old_size);
+        if (old_size >= ARENA_MIN_BLOCK) {
+            release_pages(old, (const char*)old + old_size);
+        }
     }
+    return p;
 }
 
-void* process_thread(void *arg) {
-    Process *process = (Process*)arg;
-    
-    while (process->remaining_time > 0) {
-        sem_wait(&process->semaphore);  // Wait for scheduler
+void arena_free_all(Arena* a) {
+    ArenaBlock* block = a->head;
+    while (block != NULL) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    a->head = NULL;
+    a->last = NULL;
+}
 
-        // Check if we should exit (safety check)
-        if (process->finished) {
-            break;
-        }
-        
-        pthread_mutex_lock(&scheduler_mutex);
-        
-        // Execute one unit of work
-        if (process->remaining_time > 0) {
-            process->remaining_time--;
-        }
-        
-        // Check if finished
-        if (process->remaining_time == 0) {
-            process->finished = 1;
-            process->finish_time = current_time + 1;
-            process->turnaround_time = process->finish_time - process->arrival;
+// Release everything but keep the memory. The blocks are merged into one
+// as big as all of them, so the same allocations again fit in one block.
+void arena_reset(Arena* a) {
+    if (a->head->next != NULL) {
+        size_t total = 0;
+        for (ArenaBlock* block = a->head; block != NULL; block = block->next) {
+            total += block->size;
         }
-        
-        pthread_mutex_unlock(&scheduler_mutex);
-        
-        sem_post(&scheduler_sem);  // Signal scheduler we're done with this cycle
+        arena_free_all(a);
+        a->head = arena_new_block(total);
     }
-    return NULL;
+    a->head->used = 0;
+    a->last = NULL;
+    a->last_size = 0;
 }
 
+// file parsing
 
-// queue operations
-void enqueue_process(Process* process) {
-    if (!process->in_ready_queue && !process->finished) {
-        ready_queue[ready_count] = process;
-        ready_count++;
-        process->in_ready_queue = 1;
+// Trim blanks and a trailing CR from [*start, *end)
+static void trim_field(const char** start, const char** end) {
+    while (*start < *end && (**start == ' ' || **start == '\t')) {
+        (*start)++;
+    }
+    while (*end > *start && ((*end)[-1] == ' ' || (*end)[-1] == '\t' || (*end)[-1] == '\r')) {
+        (*end)--;
     }
 }
 
-void dequeue_process(Process* process) {
-    for (int i = 0; i < ready_count; i++) {
-        if (ready_queue[i] == process) {
-            for (int j = i; j < ready_count - 1; j++) {
-                ready_queue[j] = ready_queue[j + 1];
-            }
-            ready_count--;
-            process->in_ready_queue = 0;
-            break;
+// Parse a whole field as a base 10 int, straight out of the mapped bytes
+static int parse_int_field(const char* start, const char* end, int* out) {
+    int negative = 0;
+    if (start < end && (*start == '-' || *start == '+')) {
+        negative = (*start == '-');
+        start++;
+    }
+    if (start == end) {
+        return -1;
+    }
+    long long value = 0;
+    for (const char* c = start; c < end; c++) {
+        if (*c < '0' || *c > '9') {
+            return -1;
+        }
+        value = value * 10 + (*c - '0');
+        if (value > INT_MAX) {
+            return -1;
         }
     }
+    *out = negative ? (int)-value : (int)value;
+    return 0;
 }
 
-// scheduling
-Process* select_next_process() {
-    if (ready_count == 0) {
-        return NULL;
+static uint32_t hash_pid(const char* name, uint32_t len) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (uint32_t i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
     }
+    return hash;
+}
 
-    int selected_index = 0;
+// Parse one CSV row (pid,arrival,burst,priority) in [line, eol), plus the
+// deadline at deadline_column when the header has one. Other columns are
+// ignored. The deadline is relative to arrival and may be left empty or off
+// the end of the row. The PID is returned as a hashed slice for interning.
+// Returns NULL on success or a description of the problem.
+static const char* parse_row(const char* line, const char* eol, int process, PidSlice* pid) {
+    const char* p = line;
+    int column = 0;
+    int columns = deadline_column >= 4 ? deadline_column + 1 : 4;
+    int relative_deadline = -1;
+    while (column < columns) {
+        if (p > eol) {
+            if (column >= 4) {
+                break; // optional columns left off
+            }
+            return "expected 4 columns (pid,arrival,burst,priority)";
+        }
+        const char* start = p;
+        while (p < eol && *p != ',') {
+            p++;
+        }
+        const char* end = p;
+        p++; // past the comma (or past eol on the last field)
+        trim_field(&start, &end);
 
-    switch (algorithm) {
-        case FCFS:
-            // Just pick first (already in FIFO order)
-            selected_index = 0;
-            break;
-            
-        case SJF:
-            // Find shortest remaining time
-            for (int i = 1; i < ready_count; i++) {
-                if (ready_queue[i]->remaining_time < ready_queue[selected_index]->remaining_time) {
-                    selected_index = i;
+        switch (column) {
+            case 0: // PID
+                if (start == end) {
+                    return "empty pid";
                 }
-            }
-            break;
-            
-        case RR:
-            // Round robin - just pick first
-            selected_index = 0;
-            break;
-            
-        case PRIORITY:
-            // Find highest priority (lowest number)
-            for (int i = 1; i < ready_count; i++) {
-                if (ready_queue[i]->priority < ready_queue[selected_index]->priority) {
-                    selected_index = i;
+                pid->start = start;
+                pid->len = end - start;
+                pid->hash = hash_pid(start, pid->len);
+                break;
+            case 1: // Arrival Time
+                if (parse_int_field(start, end, &processes.arrival[process]) != 0) {
+                    return "arrival is not an integer";
                 }
-            }
-            break;
-    }
-
-    return ready_queue[selected_index];
+                break;
+            case 2: // Burst Time
+                if (parse_int_field(start, end, &processes.burst[process]) != 0) {
+                    return "burst is not an integer";
+                }
+                break;
+            case 3: // Priority
+                if (parse_int_field(start, end, &processes.priority[process]) != 0) {
+                    return "priority is not an integer";
+                }
+                break;
+            default:
+                if (column == deadline_column && start != end) {
+                    if (parse_int_field(start, end, &relative_deadline) != 0 || relative_deadline < 0) {
+                        return "deadline is not a non-negative integer";
+                    }
+                }
+                break;
+        }
+        column++;
+    }
+    if (processes.arrival[process] < 0) {
+        return "arrival must not be negative";
+    }
+    if (processes.burst[process] < 1) {
+        return "burst must be positive"; // a dispatch always runs at least one unit
+    }
+    if (processes.burst[process] > INT_MAX - processes.arrival[process]) {
+        return "arrival plus burst is too large";
+    }
+    processes.deadline[process] = NO_DEADLINE;
+    if (relative_deadline >= 0) {
+        if (relative_deadline >= NO_DEADLINE - processes.arrival[process]) {
+            return "deadline is too far out";
+        }
+        processes.deadline[process] = processes.arrival[process] + relative_deadline;
+    }
+    return NULL;
+}
+
+// Column of the header field `name` in [line, eol), -1 if there is none
+static int find_header_column(const char* line, const char* eol, const char* name) {
+    size_t len = strlen(name);
+    const char* p = line;
+    for (int column = 0; p <= eol; column++) {
+        const char* start = p;
+        while (p < eol && *p != ',') {
+            p++;
+        }
+        const char* end = p;
+        p++;
+        trim_field(&start, &end);
+        if ((size_t)(end - start) == len && strncasecmp(start, name, len) == 0) {
+            return column;
+        }
+    }
+    return -1;
+}
+
+// Count the lines of a chunk. A last line without a newline still counts.
+static void count_chunk_lines(ParseChunk* chunk) {
+    int lines = 0;
+    const char* p = chunk->start;
+    while (p < chunk->end) {
+        const char* eol = memchr(p, '\n', chunk->end - p);
+        lines++;
+        if (eol == NULL) {
+            break;
+        }
+        p = eol + 1;
+    }
+    chunk->line_count = lines;
+}
+
+// Parse the rows of a chunk into processes[row_base...]. The slots are
+// reserved from the line counts, so chunks never overlap.
+static void parse_chunk_rows(ParseChunk* chunk) {
+    const char* p = chunk->start;
+    int lineNum = chunk->first_line - 1;
+    chunk->row_count = 0;
+    chunk->error_count = 0;
+    while (p < chunk->end) {
+        const char* eol = memchr(p, '\n', chunk->end - p);
+        if (eol == NULL) {
+            eol = chunk->end;
+        }
+        const char* line = p;
+        p = eol + 1;
+        lineNum++;
+
+        const char* first = line;
+        const char* last = eol;
+        trim_field(&first, &last);
+        if (first == last) { // blank line
+            continue;
+        }
+
+        int process = chunk->row_base + chunk->row_count;
+        const char* error = parse_row(line, eol, process, &pid_slices[process]);
+        if (error != NULL) {
+            if (chunk->error_count < MAX_PARSE_ERRORS) {
+                chunk->error_lines[chunk->error_count] = lineNum;
+                chunk->error_msgs[chunk->error_count] = error;
+            }
+            chunk->error_count++;
+            continue;
+        }
+        chunk->row_count++;
+    }
+}
+
+void* parse_worker(void *arg) {
+    ParseJob* job = (ParseJob*)arg;
+    processes = job->table;
+    while (1) {
+        int c = __atomic_fetch_add(&job->next_chunk, 1, __ATOMIC_RELAXED);
+        if (c >= job->chunk_count) {
+            break;
+        }
+        if (job->phase == PARSE_COUNT_LINES) {
+            count_chunk_lines(&job->chunks[c]);
+        } else {
+            parse_chunk_rows(&job->chunks[c]);
+        }
+    }
+    return NULL;
+}
+
+// Run one phase over all chunks on `threads` workers (the caller is one of them)
+void run_parse_phase(ParseJob* job, int phase, int threads) {
+    job->phase = phase;
+    job->next_chunk = 0;
+    pthread_t workers[threads];
+    int spawned = 0;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&workers[spawned], NULL, parse_worker, job) == 0) {
+            spawned++;
+        }
+    }
+    parse_worker(job);
+    for (int i = 0; i < spawned; i++) {
+        pthread_join(workers[i], NULL);
+    }
+}
+
+static double elapsed_seconds(const struct timespec* since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) + (now.tv_nsec - since->tv_nsec) / 1e9;
+}
+
+// Parse the mapped CSV directly out of the mapped bytes. The first line is
+// a header. Blank lines are skipped, malformed rows are reported with their
+// line number and abort the run.
+//
+// The body is split at newline boundaries into chunks that a pool of
+// parse_threads workers handles in two passes: count lines per chunk, which
+// gives every chunk its line numbers and a private range of process slots,
+// then parse every chunk in place. Chunks are stitched back together in
+// order afterwards, so the process table keeps the CSV row order.
+void parse_file(const char* filename) {
+    // Skipping first line, it only tells us whether there is a deadline column
+    const char* end = input_map + input_size;
+    const char* body = input_size > 0 ? memchr(input_map, '\n', input_size) : NULL;
+    deadline_column = find_header_column(input_map, body != NULL ? body : end, "deadline");
+    if (deadline_column >= 0 && deadline_column < 4) {
+        fprintf(stderr, "Error: %s: the deadline column must come after pid,arrival,burst,priority\n", filename);
+        exit(1);
+    }
+    has_deadlines = deadline_column >= 0;
+    body = body != NULL ? body + 1 : end;
+
+    int threads = parse_threads;
+    if (threads <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores > 0 ? (int)cores : 1;
+    }
+    size_t body_size = end - body;
+    if ((size_t)threads > body_size / PARSE_MIN_CHUNK) {
+        threads = body_size / PARSE_MIN_CHUNK > 0 ? (int)(body_size / PARSE_MIN_CHUNK) : 1;
+    }
+
+    // Cut the body into chunks that end right after a newline
+    int chunk_count = threads > 1 ? threads * PARSE_CHUNKS_PER_THREAD : 1;
+    ParseChunk* chunks = arena_alloc(&arena, sizeof(ParseChunk) * chunk_count);
+    const char* p = body;
+    for (int c = 0; c < chunk_count; c++) {
+        const char* cut = body + body_size * (c + 1) / chunk_count;
+        if (cut < p) {
+            cut = p;
+        }
+        if (c == chunk_count - 1) {
+            cut = end;
+        } else if (cut < end) {
+            const char* eol = memchr(cut, '\n', end - cut);
+            cut = eol != NULL ? eol + 1 : end;
+        }
+        chunks[c].start = p;
+        chunks[c].end = cut;
+        p = cut;
+    }
+
+    ParseJob job = { chunks, chunk_count, 0, PARSE_COUNT_LINES, processes };
+    run_parse_phase(&job, PARSE_COUNT_LINES, threads);
+
+    // Line counts give every chunk its first line number and its slots
+    int lines = 0;
+    for (int c = 0; c < chunk_count; c++) {
+        chunks[c].first_line = lines + 2; // line 1 is the header
+        chunks[c].row_base = lines;
+        lines += chunks[c].line_count;
+    }
+    reserve_processes(lines);
+    pid_slices = arena_alloc(&arena, sizeof(PidSlice) * (lines + 1));
+
+    job.table = processes;
+    run_parse_phase(&job, PARSE_ROWS, threads);
+
+    // Stitch the chunks together in order, closing gaps left by blank lines
+    int errors = 0;
+    process_count = 0;
+    for (int c = 0; c < chunk_count; c++) {
+        for (int e = 0; e < chunks[c].error_count && e < MAX_PARSE_ERRORS; e++) {
+            if (errors + e < MAX_PARSE_ERRORS) {
+                fprintf(stderr, "%s:%d: malformed row: %s\n", filename,
+                        chunks[c].error_lines[e], chunks[c].error_msgs[e]);
+            }
+        }
+        errors += chunks[c].error_count;
+        if (chunks[c].row_base != process_count && chunks[c].row_count > 0) {
+            int from = chunks[c].row_base;
+            int n = chunks[c].row_count;
+            memmove(&processes.arrival[process_count], &processes.arrival[from], sizeof(int) * n);
+            memmove(&processes.burst[process_count], &processes.burst[from], sizeof(int) * n);
+            memmove(&processes.priority[process_count], &processes.priority[from], sizeof(int) * n);
+            memmove(&processes.deadline[process_count], &processes.deadline[from], sizeof(int) * n);
+            memmove(&pid_slices[process_count], &pid_slices[chunks[c].row_base],
+                    sizeof(PidSlice) * chunks[c].row_count);
+        }
+        process_count += chunks[c].row_count;
+    }
+    if (errors > 0) {
+        fprintf(stderr, "Error: %d malformed row%s in %s\n", errors, errors == 1 ? "" : "s", filename);
+        exit(1);
+    }
+
+    // Intern in row order, so ids come out in order of first appearance.
+    // The hashes were already computed by the parse workers.
+    init_pid_table(process_count);
+    for (int i = 0; i < process_count; i++) {
+        // the slot a few rows ahead is almost always a cache miss, start it now
+        if (i + 16 < process_count) {
+            __builtin_prefetch(&pid_table.slots[pid_slices[i + 16].hash & pid_table.slot_mask]);
+        }
+        processes.pid_id[i] = intern_pid(pid_slices[i].start, pid_slices[i].len, pid_slices[i].hash);
+    }
+    pid_slices = NULL;
+
+    if (show_stats) {
+        fprintf(stderr, "Parsed CSV with %d parse thread%s, %d chunk%s\n",
+                threads, threads == 1 ? "" : "s", chunk_count, chunk_count == 1 ? "" : "s");
+    }
+}
+
+// Map the whole input read-only. It stays mapped until cleanup_scheduler().
+void map_input(const char* filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening file");
+        exit(1);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("Error reading file");
+        exit(1);
+    }
+    input_size = st.st_size;
+    if (input_size > 0) {
+        void* map = mmap(NULL, input_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            perror("Error mapping file");
+            exit(1);
+        }
+        madvise(map, input_size, MADV_SEQUENTIAL);
+        input_map = map;
+    }
+    close(fd);
+}
+
+static int is_binary_workload(void) {
+    return input_size >= sizeof(WorkloadHeader) &&
+           memcmp(input_map, WORKLOAD_MAGIC, sizeof(((WorkloadHeader*)0)->magic)) == 0;
+}
+
+// Fill the process table from either a binary workload or a CSV, picked by
+// the magic bytes at the start of the file
+void load_workload(const char* filename) {
+    struct timespec load_start;
+    clock_gettime(CLOCK_MONOTONIC, &load_start);
+
+    map_input(filename);
+    int binary = is_binary_workload();
+    if (binary) {
+        load_binary(filename);
+    } else {
+        parse_file(filename);
+    }
+    build_arrival_order();
+    reset_processes();
+
+    if (show_stats) {
+        double seconds = elapsed_seconds(&load_start);
+        fprintf(stderr, "Loaded %d processes from %s (%s, %.1f MB) in %.3f s, %.2f M rows/s\n",
+                process_count, filename, binary ? "binary" : "CSV",
+                input_size / (1024.0 * 1024.0), seconds,
+                seconds > 0 ? process_count / seconds / 1e6 : 0.0);
+    }
+}
+
+static uint32_t column_type_width(uint32_t type) {
+    switch (type) {
+        case COLUMN_U8: return sizeof(uint8_t);
+        case COLUMN_U32: return sizeof(uint32_t);
+        case COLUMN_I32: return sizeof(int32_t);
+        case COLUMN_U64: return sizeof(uint64_t);
+        default: return 0;
+    }
+}
+
+// Find a column by name and check its shape, NULL if absent. The array has
+// to be aligned for its type and lie inside the file, since it is read in
+// place from the mapping.
+static const WorkloadColumn* find_column(const char* filename, const char* name,
+                                         uint32_t type, uint64_t count) {
+    const WorkloadHeader* header = (const WorkloadHeader*)input_map;
+    const WorkloadColumn* columns = (const WorkloadColumn*)(input_map + sizeof(WorkloadHeader));
+    uint32_t width = column_type_width(type);
+    for (uint32_t c = 0; c < header->column_count; c++) {
+        if (strncmp(columns[c].name, name, WORKLOAD_COLUMN_NAME) != 0) {
+            continue;
+        }
+        if (columns[c].type != type || columns[c].width != width ||
+            (count != UINT64_MAX && columns[c].count != count) ||
+            columns[c].offset > input_size || columns[c].offset % width != 0 ||
+            columns[c].count > (input_size - columns[c].offset) / width) {
+            fprintf(stderr, "Error: %s: column '%s' is corrupt\n", filename, name);
+            exit(1);
+        }
+        return &columns[c];
+    }
+    return NULL;
+}
+
+static const WorkloadColumn* require_column(const char* filename, const char* name,
+                                            uint32_t type, uint64_t count) {
+    const WorkloadColumn* column = find_column(filename, name, type, count);
+    if (column == NULL) {
+        fprintf(stderr, "Error: %s: missing column '%s'\n", filename, name);
+        exit(1);
+    }
+    return column;
+}
+
+// Load a binary workload. The columns are read in place from the mapping,
+// nothing is parsed per row.
+void load_binary(const char* filename) {
+    const WorkloadHeader* header = (const WorkloadHeader*)input_map;
+    if (header->version != WORKLOAD_VERSION || header->byte_order != WORKLOAD_BYTE_ORDER) {
+        fprintf(stderr, "Error: %s: unsupported workload version or byte order\n", filename);
+        exit(1);
+    }
+    if (header->row_count > INT_MAX ||
+        header->column_count > (input_size - sizeof(WorkloadHeader)) / sizeof(WorkloadColumn)) {
+        fprintf(stderr, "Error: %s: corrupt workload header\n", filename);
+        exit(1);
+    }
+    int rows = (int)header->row_count;
+    const uint32_t* pid_ids = (const uint32_t*)(input_map +
+        require_column(filename, "pid_id", COLUMN_U32, rows)->offset);
+    const int32_t* arrivals = (const int32_t*)(input_map +
+        require_column(filename, "arrival", COLUMN_I32, rows)->offset);
+    const int32_t* bursts = (const int32_t*)(input_map +
+        require_column(filename, "burst", COLUMN_I32, rows)->offset);
+    const int32_t* priorities = (const int32_t*)(input_map +
+        require_column(filename, "priority", COLUMN_I32, rows)->offset);
+    const WorkloadColumn* offsets_column = require_column(filename, "pid_name_offsets", COLUMN_U64, UINT64_MAX);
+    const WorkloadColumn* bytes_column = require_column(filename, "pid_name_bytes", COLUMN_U8, UINT64_MAX);
+    const uint64_t* name_offsets = (const uint64_t*)(input_map + offsets_column->offset);
+    const char* name_bytes = input_map + bytes_column->offset;
+    uint64_t name_count = offsets_column->count > 0 ? offsets_column->count - 1 : 0;
+
+    if (name_count > UINT32_MAX - 1) {
+        fprintf(stderr, "Error: %s: corrupt pid name table\n", filename);
+        exit(1);
+    }
+
+    // The name table was written from an interned table, so it is adopted
+    // as is and the row ids are used directly
+    init_pid_table(0);
+    pid_table.names = arena_alloc(&arena, sizeof(PidSlice) * (name_count + 1));
+    pid_table.capacity = name_count + 1;
+    for (uint64_t k = 0; k < name_count; k++) {
+        if (name_offsets[k] > name_offsets[k + 1] || name_offsets[k + 1] > bytes_column->count) {
+            fprintf(stderr, "Error: %s: corrupt pid name table\n", filename);
+            exit(1);
+        }
+        pid_table.names[k].start = name_bytes + name_offsets[k];
+        pid_table.names[k].len = (uint32_t)(name_offsets[k + 1] - name_offsets[k]);
+        pid_table.names[k].hash = 0;
+    }
+    pid_table.count = name_count;
+
+    reserve_processes(rows);
+    for (int i = 0; i < rows; i++) {
+        if (pid_ids[i] >= name_count) {
+            fprintf(stderr, "Error: %s: row %d has a bad pid id\n", filename, i);
+            exit(1);
+        }
+        if (arrivals[i] < 0 || bursts[i] < 1) {
+            fprintf(stderr, "Error: %s: row %d has a negative arrival or a burst below 1\n", filename, i);
+            exit(1);
+        }
+        if (bursts[i] > INT_MAX - arrivals[i]) {
+            fprintf(stderr, "Error: %s: row %d has an arrival plus burst that is too large\n", filename, i);
+            exit(1);
+        }
+    }
+    // the columns already have the table's layout, copy them over whole
+    memcpy(processes.pid_id, pid_ids, sizeof(uint32_t) * rows);
+    memcpy(processes.arrival, arrivals, sizeof(int) * rows);
+    memcpy(processes.burst, bursts, sizeof(int) * rows);
+    memcpy(processes.priority, priorities, sizeof(int) * rows);
+    const WorkloadColumn* deadlines = find_column(filename, "deadline", COLUMN_I32, rows);
+    has_deadlines = deadlines != NULL;
+    if (has_deadlines) {
+        memcpy(processes.deadline, input_map + deadlines->offset, sizeof(int) * rows);
+    } else {
+        for (int i = 0; i < rows; i++) {
+            processes.deadline[i] = NO_DEADLINE;
+        }
+    }
+    process_count = rows;
+}
+
+// converting
+int run_convert(int argc, char* argv[]) {
+    char* input = NULL;
+    char* output = NULL;
+
+    static struct option long_opts[] = {
+        {"input", required_argument, 0, 'i'},
+        {"output", required_argument, 0, 'o'},
+        {"parse-threads", required_argument, 0, 'T'},
+        {"stats", no_argument, 0, 'S'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "i:o:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+            case 'i':
+                input = optarg;
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'T':
+                if (!parse_int_option(optarg, 0, &parse_threads)) {
+                    fprintf(stderr, "Error: --parse-threads must be 0 (one per core) or positive.\n");
+                    return 1;
+                }
+                break;
+            case 'S':
+                show_stats = 1;
+                break;
+            case 'h':
+                print_usage("schedsim");
+                return 0;
+            default:
+                print_usage("schedsim");
+                return 1;
+        }
+    }
+    if (input == NULL || output == NULL) {
+        fprintf(stderr, "Error: convert needs an input and an output file.\n\n");
+        print_usage("schedsim");
+        return 1;
+    }
+
+    initialize_scheduler(input);
+    load_workload(input);
+    write_binary_workload(output);
+    cleanup_scheduler();
+    return 0;
+}
+
+// queue benchmark
+//
+// Steady state select / dequeue / re-enqueue on a PRIORITY queue of fixed
+// length, once with the flat scan and once with the heap, using the same
+// queue code the scheduler runs.
+static double bench_queue_ns(int size, int crossover, long ops) {
+    reserve_processes(size);
+    process_count = size;
+    unsigned int rng = 12345u;
+    for (int i = 0; i < size; i++) {
+        rng = rng * 1103515245u + 12345u;
+        processes.priority[i] = (rng >> 16) % 64;
+        processes.flags[i] = 0;
+    }
+    queue_crossover = crossover;
+    init_ready_queue(QUEUE_FLAT);
+    for (int i = 0; i < size; i++) {
+        enqueue_process(i, processes.priority[i]);
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long k = 0; k < ops; k++) {
+        int process = select_next_process();
+        dequeue_process(process);
+        rng = rng * 1103515245u + 12345u;
+        processes.priority[process] = (rng >> 16) % 64;
+        enqueue_process(process, processes.priority[process]);
+    }
+    return elapsed_seconds(&start) * 1e9 / ops;
+}
+
+int run_bench_queue(int argc, char* argv[]) {
+    long ops = 2000000;
+
+    static struct option long_opts[] = {
+        {"ops", required_argument, 0, 'n'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_opts, NULL)) != -1) {
+        switch (opt) {
+            case 'n':
+                ops = atol(optarg);
+                break;
+            case 'h':
+                print_usage("schedsim");
+                return 0;
+            default:
+                print_usage("schedsim");
+                return 1;
+        }
+    }
+    if (ops <= 0) {
+        fprintf(stderr, "Error: --ops must be positive.\n");
+        return 1;
+    }
+
+    static const int sizes[] = { 4, 8, 16, 32, 64, 128, 192, 256, 320, 384, 448, 512, 1024 };
+    int size_count = sizeof(sizes) / sizeof(sizes[0]);
+    arena_init(&arena, (size_t)sizes[size_count - 1] * 64);
+
+    printf("%8s %12s %12s\n", "queue", "flat ns/op", "heap ns/op");
+    int crossover = -1;
+    for (int i = 0; i < size_count; i++) {
+        double flat = bench_queue_ns(sizes[i], sizes[i] + 1, ops);
+        double heap = bench_queue_ns(sizes[i], 0, ops);
+        printf("%8d %12.1f %12.1f\n", sizes[i], flat, heap);
+        if (crossover < 0 && heap < flat) {
+            crossover = sizes[i];
+        }
+    }
+    if (crossover < 0) {
+        printf("Flat scan wins at every size, use --queue-crossover=%d or more\n", sizes[size_count - 1]);
+    } else {
+        printf("Heap wins from %d entries, use --queue-crossover=%d\n", crossover, crossover);
+    }
+
+    arena_free_all(&arena);
+    return 0;
+}
+
+static uint64_t align8(uint64_t offset) {
+    return (offset + 7) & ~(uint64_t)7;
+}
+
+static void write_column(FILE* file, uint64_t offset, const void* data, size_t size) {
+    if (fseek(file, (long)offset, SEEK_SET) != 0 || fwrite(data, 1, size, file) != size) {
+        perror("Error writing workload");
+        exit(1);
+    }
+}
+
+// Lay the columns out after the header and the column table, 8-byte
+// aligned, and write those two. Returns the size of the whole file.
+static uint64_t write_workload_header(FILE* file, WorkloadColumn* columns, int column_count, uint64_t rows) {
+    uint64_t offset = sizeof(WorkloadHeader) + sizeof(WorkloadColumn) * column_count;
+    for (int c = 0; c < column_count; c++) {
+        offset = align8(offset);
+        columns[c].offset = offset;
+        offset += columns[c].count * columns[c].width;
+    }
+
+    WorkloadHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, WORKLOAD_MAGIC, sizeof(header.magic));
+    header.version = WORKLOAD_VERSION;
+    header.byte_order = WORKLOAD_BYTE_ORDER;
+    header.row_count = rows;
+    header.column_count = column_count;
+    write_column(file, 0, &header, sizeof(header));
+    write_column(file, sizeof(header), columns, sizeof(WorkloadColumn) * column_count);
+    return offset;
+}
+
+// Write the loaded process table as a binary workload, with the interned
+// pid table as its name table
+void write_binary_workload(const char* filename) {
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL) {
+        perror("Error opening output file");
+        exit(1);
+    }
+
+    uint64_t rows = process_count;
+    uint64_t names_count = pid_table.count;
+    uint64_t name_bytes = 0;
+    for (uint32_t k = 0; k < pid_table.count; k++) {
+        name_bytes += pid_table.names[k].len;
+    }
+
+    WorkloadColumn columns[] = {
+        {"pid_id", COLUMN_U32, 4, rows, 0},
+        {"arrival", COLUMN_I32, 4, rows, 0},
+        {"burst", COLUMN_I32, 4, rows, 0},
+        {"priority", COLUMN_I32, 4, rows, 0},
+        {"pid_name_offsets", COLUMN_U64, 8, names_count + 1, 0},
+        {"pid_name_bytes", COLUMN_U8, 1, name_bytes, 0},
+        {"deadline", COLUMN_I32, 4, rows, 0}, // optional, kept last
+    };
+    int column_count = sizeof(columns) / sizeof(columns[0]);
+    if (!has_deadlines) {
+        column_count--;
+    }
+    uint64_t offset = write_workload_header(file, columns, column_count, rows);
+
+    // the table columns are written as they are
+    write_column(file, columns[0].offset, processes.pid_id, 4 * rows);
+    write_column(file, columns[1].offset, processes.arrival, 4 * rows);
+    write_column(file, columns[2].offset, processes.burst, 4 * rows);
+    write_column(file, columns[3].offset, processes.priority, 4 * rows);
+
+    uint64_t* name_offsets = arena_alloc(&arena, sizeof(uint64_t) * (names_count + 1));
+    char* names = arena_alloc(&arena, name_bytes + 1);
+    uint64_t at = 0;
+    for (uint32_t k = 0; k < pid_table.count; k++) {
+        name_offsets[k] = at;
+        memcpy(names + at, pid_table.names[k].start, pid_table.names[k].len);
+        at += pid_table.names[k].len;
+    }
+    name_offsets[names_count] = at;
+    write_column(file, columns[4].offset, name_offsets, 8 * (names_count + 1));
+    write_column(file, columns[5].offset, names, name_bytes);
+    if (has_deadlines) {
+        write_column(file, columns[6].offset, processes.deadline, 4 * rows);
+    }
+
+    if (fclose(file) != 0) {
+        perror("Error writing workload");
+        exit(1);
+    }
+    if (show_stats) {
+        fprintf(stderr, "Wrote %d processes to %s (%.1f MB)\n",
+                process_count, filename, offset / (1024.0 * 1024.0));
+    }
+}
+
+static int compare_arrival(const void* a, const void* b) {
+    int ia = *(const int*)a;
+    int ib = *(const int*)b;
+    if (processes.arrival[ia] != processes.arrival[ib]) {
+        return processes.arrival[ia] < processes.arrival[ib] ? -1 : 1;
+    }
+    return ia - ib; // keep CSV order among equal arrivals
+}
+
+void build_arrival_order(void) {
+    arrival_order = arena_alloc(&arena, sizeof(int) * (process_count + 1));
+    int sorted = 1;
+    for (int i = 0; i < process_count; i++) {
+        arrival_order[i] = i;
+        if (i > 0 && processes.arrival[i] < processes.arrival[i - 1]) {
+            sorted = 0;
+        }
+    }
+    // traces are usually already in arrival order, only sort when they are not
+    if (!sorted) {
+        qsort(arrival_order, process_count, sizeof(int), compare_arrival);
+    }
+    arrival_cursor = 0;
+}
+
+// Make room for `capacity` processes, keeping the rows already loaded
+void reserve_processes(int capacity) {
+    if (capacity <= process_capacity) {
+        return;
+    }
+    size_t n = capacity;
+    size_t keep = process_count;
+    processes.arrival = arena_grow(&arena, processes.arrival, sizeof(int) * keep, sizeof(int) * n);
+    processes.remaining_time = arena_grow(&arena, processes.remaining_time, sizeof(int) * keep, sizeof(int) * n);
+    processes.priority = arena_grow(&arena, processes.priority, sizeof(int) * keep, sizeof(int) * n);
+    processes.queue_index = arena_grow(&arena, processes.queue_index, sizeof(int) * keep, sizeof(int) * n);
+    processes.flags = arena_grow(&arena, processes.flags, keep, n);
+    processes.pid_id = arena_grow(&arena, processes.pid_id, sizeof(uint32_t) * keep, sizeof(uint32_t) * n);
+    processes.burst = arena_grow(&arena, processes.burst, sizeof(int) * keep, sizeof(int) * n);
+    processes.start_time = arena_grow(&arena, processes.start_time, sizeof(int) * keep, sizeof(int) * n);
+    processes.finish_time = arena_grow(&arena, processes.finish_time, sizeof(int) * keep, sizeof(int) * n);
+    processes.deadline = arena_grow(&arena, processes.deadline, sizeof(int) * keep, sizeof(int) * n);
+    process_capacity = capacity;
+}
+
+// Reset the per-run columns from the input columns
+void reset_processes(void) {
+    memcpy(processes.remaining_time, processes.burst, sizeof(int) * process_count);
+    memset(processes.flags, 0, process_count);
+    for (int i = 0; i < process_count; i++) {
+        processes.start_time[i] = -1;
+        processes.finish_time[i] = 0;
+    }
+}
+
+void spawn_threads() {
+    save_run_state(&process_thread_run);
+    process_threads = arena_alloc(&arena, sizeof(ProcessThread) * process_count);
+    for (int i = 0; i < process_count; i++) {
+        sem_init(&process_threads[i].semaphore, 0, 0); // Initialize semaphore
+        pthread_create(&process_threads[i].thread, NULL, process_thread, (void*)(intptr_t)i);
+    }
+}
+
+void wait_threads() {
+    for (int i = 0; i < process_count; i++) {
+        pthread_join(process_threads[i].thread, NULL); // Join the thread
+        sem_destroy(&process_threads[i].semaphore); // Also destroy the semaphore
+    }
+}
+
+void* process_thread(void *arg) {
+    int process = (int)(intptr_t)arg;
+    ProcessThread* self = &process_threads[process];
+    adopt_run_state(&process_thread_run);
+    
+    while (processes.remaining_time[process] > 0) {
+        sem_wait(&self->semaphore);  // Wait for scheduler
+
+        // Check if we should exit (safety check)
+        if (processes.flags[process] & PROCESS_FINISHED) {
+            break;
+        }
+        
+        pthread_mutex_lock(&scheduler_mutex);
+        execute_process(process, self->run_start, self->run_units);
+        pthread_mutex_unlock(&scheduler_mutex);
+        
+        sem_post(&scheduler_sem);  // Signal scheduler we're done with this cycle
+    }
+    return NULL;
+}
+
+// Snapshot of this thread's run state, for helper threads to adopt
+void save_run_state(RunState* state) {
+    state->processes = processes;
+    state->cpus = cpus;
+    state->last_cpu = last_cpu;
+    state->algorithm = algorithm;
+    state->time_quantum = time_quantum;
+    memcpy(state->mlfq_quanta, mlfq_quanta, sizeof(mlfq_quanta));
+}
+
+// Work on the run `state` was saved from. The pointers are shared, so the
+// helper sees and makes the same changes as the thread that saved it.
+void adopt_run_state(const RunState* state) {
+    processes = state->processes;
+    cpus = state->cpus;
+    last_cpu = state->last_cpu;
+    algorithm = state->algorithm;
+    time_quantum = state->time_quantum;
+    memcpy(mlfq_quanta, state->mlfq_quanta, sizeof(mlfq_quanta));
+}
+
+// Execute the units of work the scheduler granted for the dispatch starting
+// at `start`. Called from the process thread (threaded engine) or inline by
+// the scheduler (direct).
+void execute_process(int process, int start, int units) {
+    if (units > processes.remaining_time[process]) {
+        units = processes.remaining_time[process];
+    }
+    processes.remaining_time[process] -= units;
+    
+    // Check if finished
+    if (processes.remaining_time[process] == 0) {
+        processes.flags[process] |= PROCESS_FINISHED;
+        processes.finish_time[process] = start + units;
+    }
+}
+
+// pid interning
+void init_pid_table(uint32_t expected) {
+    uint32_t slots = 16;
+    while (slots < expected * 2) {
+        slots *= 2;
+    }
+    pid_table.slots = arena_alloc(&arena, sizeof(PidSlot) * slots);
+    memset(pid_table.slots, 0, sizeof(PidSlot) * slots);
+    pid_table.slot_mask = slots - 1;
+    pid_table.capacity = expected + 1;
+    pid_table.names = arena_alloc(&arena, sizeof(PidSlice) * pid_table.capacity);
+    pid_table.count = 0;
+}
+
+static void grow_pid_slots(void) {
+    uint32_t slots = (pid_table.slot_mask + 1) * 2;
+    pid_table.slots = arena_alloc(&arena, sizeof(PidSlot) * slots);
+    memset(pid_table.slots, 0, sizeof(PidSlot) * slots);
+    pid_table.slot_mask = slots - 1;
+    for (uint32_t id = 0; id < pid_table.count; id++) {
+        uint32_t slot = pid_table.names[id].hash & pid_table.slot_mask;
+        while (pid_table.slots[slot].id != 0) {
+            slot = (slot + 1) & pid_table.slot_mask;
+        }
+        pid_table.slots[slot].hash = pid_table.names[id].hash;
+        pid_table.slots[slot].id = id + 1;
+    }
+}
+
+// Id of `name`, adding it to the table the first time it is seen
+uint32_t intern_pid(const char* name, uint32_t len, uint32_t hash) {
+    uint32_t slot = hash & pid_table.slot_mask;
+    while (pid_table.slots[slot].id != 0) {
+        if (pid_table.slots[slot].hash == hash) {
+            uint32_t id = pid_table.slots[slot].id - 1;
+            PidSlice* entry = &pid_table.names[id];
+            if (entry->len == len && memcmp(entry->start, name, len) == 0) {
+                return id;
+            }
+        }
+        slot = (slot + 1) & pid_table.slot_mask;
+    }
+    if (pid_table.count == pid_table.capacity) {
+        pid_table.names = arena_grow(&arena, pid_table.names, sizeof(PidSlice) * pid_table.capacity,
+                                     sizeof(PidSlice) * pid_table.capacity * 2);
+        pid_table.capacity *= 2;
+    }
+    uint32_t id = pid_table.count++;
+    pid_table.names[id].start = name;
+    pid_table.names[id].len = len;
+    pid_table.names[id].hash = hash;
+    pid_table.slots[slot].hash = hash;
+    pid_table.slots[slot].id = id + 1;
+    if (pid_table.count * 2 > pid_table.slot_mask + 1) {
+        grow_pid_slots();
+    }
+    return id;
+}
+
+const char* pid_name(uint32_t id, int* len) {
+    if (stream_mode) {
+        // streamed processes are named by slot
+        *len = stream.names[id].len;
+        return stream.names[id].start;
+    }
+    if (input_generated) {
+        // generated processes are P1, P2, ... by row
+        static __thread char name[16];
+        *len = snprintf(name, sizeof(name), "P%u", id + 1);
+        return name;
+    }
+    *len = pid_table.names[id].len;
+    return pid_table.names[id].start;
+}
+
+// latency histograms
+//
+// Log-linear buckets in the style of HdrHistogram. Values below
+// 2^HIST_SUB_BITS get a bucket each. Above that each power of two is cut
+// into HIST_HALF equal buckets, so a bucket is never wider than 1/64 of
+// the values in it. Recording is a shift and an add, the size is fixed
+// however long the run, and two histograms merge by adding buckets, so
+// what host threads, sweep runs or Monte Carlo workloads recorded apart
+// combines exactly.
+static inline int hist_bucket(int value) {
+    if (value < (1 << HIST_SUB_BITS)) {
+        return value;
+    }
+    int shift = 31 - __builtin_clz((unsigned)value) - HIST_SUB_BITS + 1;
+    return shift * HIST_HALF + (value >> shift);
+}
+
+// largest value that lands in `bucket`
+static int hist_bucket_top(int bucket) {
+    if (bucket < (1 << HIST_SUB_BITS)) {
+        return bucket;
+    }
+    int shift = bucket / HIST_HALF - 1;
+    int64_t top = ((int64_t)(bucket - shift * HIST_HALF + 1) << shift) - 1;
+    return top > INT_MAX ? INT_MAX : (int)top;
+}
+
+void hist_record(Histogram* hist, int value) {
+    if (value < 0) {
+        value = 0; // the metrics never go below zero
+    }
+    hist->buckets[hist_bucket(value)]++;
+    hist->count++;
+    hist->sum += value;
+    if (value > hist->max) {
+        hist->max = value;
+    }
+}
+
+void hist_merge(Histogram* into, const Histogram* from) {
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        into->buckets[b] += from->buckets[b];
+    }
+    into->count += from->count;
+    into->sum += from->sum;
+    if (from->max > into->max) {
+        into->max = from->max;
+    }
+}
+
+// Smallest recorded value with at least `q` of the values at or below it,
+// as the top of its bucket (never above the largest recorded value)
+int hist_percentile(const Histogram* hist, double q) {
+    if (hist->count == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)ceil(q * hist->count);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += hist->buckets[b];
+        if (seen >= rank) {
+            int top = hist_bucket_top(b);
+            return top < hist->max ? top : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+RunMetrics* new_run_metrics(void) {
+    RunMetrics* metrics = arena_alloc(&arena, sizeof(RunMetrics));
+    memset(metrics, 0, sizeof(RunMetrics));
+    return metrics;
+}
+
+void merge_run_metrics(RunMetrics* into, const RunMetrics* from) {
+    for (int m = 0; m < METRIC_COUNT; m++) {
+        hist_merge(&into->metric[m], &from->metric[m]);
+    }
+    into->deadline_count += from->deadline_count;
+    into->deadline_misses += from->deadline_misses;
+}
+
+// A process just finished, record it in this thread's run_metrics
+void record_completion(int process) {
+    int turnaround_time = processes.finish_time[process] - processes.arrival[process];
+    hist_record(&run_metrics->metric[METRIC_WAIT], turnaround_time - processes.burst[process]);
+    hist_record(&run_metrics->metric[METRIC_RESP], processes.start_time[process] - processes.arrival[process]);
+    hist_record(&run_metrics->metric[METRIC_TURN], turnaround_time);
+    if (has_deadlines && processes.deadline[process] != NO_DEADLINE) {
+        run_metrics->deadline_count++;
+        run_metrics->deadline_misses += processes.finish_time[process] > processes.deadline[process];
+    }
+}
+
+// gantt chart
+void gantt_lane_init(GanttLane* lane, int segments) {
+    memset(lane, 0, sizeof(GanttLane));
+    lane->open.pid_id = GANTT_IDLE;
+    lane->encoded_pid = GANTT_IDLE;
+    if (gantt_compact) {
+        lane->capacity = (size_t)segments * GANTT_COMPACT_BYTES + 16;
+        lane->bytes = arena_alloc(&arena, lane->capacity);
+    } else {
+        lane->capacity = segments > 0 ? segments : 1;
+        lane->entries = arena_alloc(&arena, sizeof(GanttEntry) * lane->capacity);
+    }
+}
+
+static inline uint8_t* put_varint(uint8_t* at, uint64_t value) {
+    while (value >= 0x80) {
+        *at++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *at++ = (uint8_t)value;
+    return at;
+}
+
+static inline uint64_t get_varint(const uint8_t** at) {
+    uint64_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t byte = *(*at)++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return value;
+        }
+    }
+}
+
+// A closed segment of a compact lane. It starts where the one before it
+// ended, so only two varints are written: the change of pid_id (zigzag,
+// idle counting as id -1) and the length. Round robin between a few
+// processes takes two or three bytes a segment instead of 12.
+static void gantt_encode(GanttLane* lane, const GanttEntry* segment) {
+    if (lane->capacity - lane->used < 16) { // two varints at most
+        lane->bytes = arena_grow(&arena, lane->bytes, lane->used, lane->capacity * 2);
+        lane->capacity *= 2;
+    }
+    int64_t delta = (int64_t)(uint32_t)(segment->pid_id + 1) - (int64_t)(uint32_t)(lane->encoded_pid + 1);
+    uint8_t* at = lane->bytes + lane->used;
+    at = put_varint(at, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+    at = put_varint(at, (uint32_t)(segment->end - segment->start));
+    lane->used = at - lane->bytes;
+    lane->encoded_pid = segment->pid_id;
+}
+
+static void gantt_push(GanttLane* lane, uint32_t pid_id, int start, int end) {
+    lane->end = end;
+    if (lane->bytes != NULL) {
+        if (lane->count > 0 && lane->open.pid_id == pid_id) {
+            lane->open.end = end;
+            return;
+        }
+        if (lane->count > 0) {
+            gantt_encode(lane, &lane->open);
+        } else {
+            lane->origin = start;
+        }
+        lane->open.pid_id = pid_id;
+        lane->open.start = start;
+        lane->open.end = end;
+        lane->count++;
+        return;
+    }
+    if (lane->count > 0 && lane->entries[lane->count - 1].pid_id == pid_id) {
+        lane->entries[lane->count - 1].end = end;
+        return;
+    }
+    if (lane->count == (int)lane->capacity && stream_mode && lane == &gantt_chart) {
+        flush_gantt_band();
+    } else if (lane->count == (int)lane->capacity) {
+        lane->entries = arena_grow(&arena, lane->entries, sizeof(GanttEntry) * lane->capacity,
+                                   sizeof(GanttEntry) * lane->capacity * 2);
+        lane->capacity *= 2;
+    }
+    if (lane->count == 0) {
+        lane->origin = start;
+    }
+    lane->entries[lane->count].pid_id = pid_id;
+    lane->entries[lane->count].start = start;
+    lane->entries[lane->count].end = end;
+    lane->count++;
+}
+
+// Add a run of `pid_id` from start to end, after an idle segment if the
+// lane has been empty since its last one ended
+void gantt_append(GanttLane* lane, uint32_t pid_id, int start, int end) {
+    if (!gantt_recording) {
+        return;
+    }
+    if (start > lane->end) {
+        gantt_push(lane, GANTT_IDLE, lane->end, start);
+    }
+    gantt_push(lane, pid_id, start, end);
+}
+
+void add_gantt_entry(int process, int start, int end) {
+    gantt_append(&gantt_chart, processes.pid_id[process], start, end);
+}
+
+void gantt_cursor_init(GanttCursor* cursor, const GanttLane* lane) {
+    cursor->lane = lane;
+    cursor->at = 0;
+    cursor->index = 0;
+    cursor->time = lane->origin;
+    cursor->pid_id = GANTT_IDLE;
+}
+
+// The next segment of a compact lane, 0 after the last
+int gantt_cursor_next(GanttCursor* cursor, GanttEntry* entry) {
+    const GanttLane* lane = cursor->lane;
+    if (cursor->index == lane->count) {
+        return 0;
+    }
+    cursor->index++;
+    if (cursor->index == lane->count) {
+        *entry = lane->open;
+        return 1;
+    }
+    const uint8_t* at = lane->bytes + cursor->at;
+    uint64_t zigzag = get_varint(&at);
+    int64_t delta = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+    cursor->pid_id = (uint32_t)((int64_t)(uint32_t)(cursor->pid_id + 1) + delta) - 1;
+    entry->pid_id = cursor->pid_id;
+    entry->start = cursor->time;
+    entry->end = cursor->time + (int)get_varint(&at);
+    cursor->time = entry->end;
+    cursor->at = at - lane->bytes;
+    return 1;
+}
+
+// Memory the lane's segments take up
+size_t gantt_lane_bytes(const GanttLane* lane) {
+    if (lane->bytes != NULL) {
+        return lane->used + sizeof(GanttEntry);
+    }
+    return sizeof(GanttEntry) * lane->count;
+}
+
+// argmin kernels
+//
+// Index of the first smallest key. Picked once at startup from what the CPU
+// supports: AVX2, SSE4.1, or a plain loop. The vector versions find the
+// minimum first and then the first lane equal to it, so ties still go to
+// the lowest index (the earliest enqueued process).
+int (*argmin_kernel)(const int* keys, int count) = argmin_scalar;
+
+int argmin_scalar(const int* keys, int count) {
+    int best = 0;
+    for (int i = 1; i < count; i++) {
+        if (keys[i] < keys[best]) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("sse4.1")))
+static int argmin_sse41(const int* keys, int count) {
+    if (count < 8) {
+        return argmin_scalar(keys, count);
+    }
+    __m128i vmin = _mm_loadu_si128((const __m128i*)keys);
+    int i = 4;
+    for (; i + 4 <= count; i += 4) {
+        vmin = _mm_min_epi32(vmin, _mm_loadu_si128((const __m128i*)(keys + i)));
+    }
+    vmin = _mm_min_epi32(vmin, _mm_shuffle_epi32(vmin, _MM_SHUFFLE(1, 0, 3, 2)));
+    vmin = _mm_min_epi32(vmin, _mm_shuffle_epi32(vmin, _MM_SHUFFLE(2, 3, 0, 1)));
+    int min = _mm_cvtsi128_si32(vmin);
+    for (; i < count; i++) {
+        if (keys[i] < min) {
+            min = keys[i];
+        }
+    }
+
+    __m128i target = _mm_set1_epi32(min);
+    for (i = 0; i + 4 <= count; i += 4) {
+        __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(keys + i)), target);
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    for (; keys[i] != min; i++) {
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static int argmin_avx2(const int* keys, int count) {
+    if (count < 16) {
+        return argmin_scalar(keys, count);
+    }
+    __m256i vmin = _mm256_loadu_si256((const __m256i*)keys);
+    int i = 8;
+    for (; i + 8 <= count; i += 8) {
+        vmin = _mm256_min_epi32(vmin, _mm256_loadu_si256((const __m256i*)(keys + i)));
+    }
+    __m128i half = _mm_min_epi32(_mm256_castsi256_si128(vmin), _mm256_extracti128_si256(vmin, 1));
+    half = _mm_min_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_min_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    int min = _mm_cvtsi128_si32(half);
+    for (; i < count; i++) {
+        if (keys[i] < min) {
+            min = keys[i];
+        }
+    }
+
+    __m256i target = _mm256_set1_epi32(min);
+    for (i = 0; i + 8 <= count; i += 8) {
+        __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(keys + i)), target);
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    for (; keys[i] != min; i++) {
+    }
+    return i;
+}
+#endif
+
+void init_argmin_kernel(void) {
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        argmin_kernel = argmin_avx2;
+        return;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        argmin_kernel = argmin_sse41;
+        return;
+    }
+#endif
+    argmin_kernel = argmin_scalar;
+}
+
+// queue operations
+// `kind` is QUEUE_RING for a FIFO queue or QUEUE_FLAT for a keyed one,
+// which becomes a heap by itself once it grows long
+void init_ready_queue(ReadyQueueKind kind) {
+    // a process is in the ready queue at most once, so with one queue for
+    // everything this never grows. Per-CPU queues start smaller and grow.
+    ready_queue.capacity = run_queue_capacity > 0 ? run_queue_capacity : process_count + 1;
+    if (kind != QUEUE_RING) {
+        ready_queue.kind = QUEUE_FLAT;
+        ready_queue.flat_capacity = queue_crossover < process_count ? queue_crossover : process_count;
+        if (ready_queue.flat_capacity < 0) {
+            ready_queue.flat_capacity = 0;
+        }
+        if (ready_queue.capacity <= ready_queue.flat_capacity) {
+            ready_queue.capacity = ready_queue.flat_capacity + 1;
+        }
+        ready_queue.heap = arena_alloc(&arena, sizeof(HeapEntry) * ready_queue.capacity);
+        ready_queue.flat_keys = arena_alloc(&arena, sizeof(int) * (ready_queue.flat_capacity + 1));
+        ready_queue.flat_procs = arena_alloc(&arena, sizeof(int) * (ready_queue.flat_capacity + 1));
+        ready_queue.flat_seqs = arena_alloc(&arena, sizeof(uint64_t) * (ready_queue.flat_capacity + 1));
+        ready_queue.flat_hint = 0;
+        ready_queue.flat_best_valid = 0;
+    } else {
+        ready_queue.kind = QUEUE_RING;
+        ready_queue.ring = arena_alloc(&arena, sizeof(int) * ready_queue.capacity);
+    }
+    ready_queue.head = 0;
+    ready_queue.count = 0;
+    ready_queue.next_seq = 0;
+}
+
+static int heap_less(const HeapEntry* a, const HeapEntry* b) {
+    if (a->key != b->key) {
+        return a->key < b->key;
+    }
+    return a->seq < b->seq;
+}
+
+static void heap_place(int i, HeapEntry entry) {
+    ready_queue.heap[i] = entry;
+    processes.queue_index[entry.process] = i;
+}
+
+static void heap_sift_up(int i) {
+    HeapEntry entry = ready_queue.heap[i];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!heap_less(&entry, &ready_queue.heap[parent])) {
+            break;
+        }
+        heap_place(i, ready_queue.heap[parent]);
+        i = parent;
+    }
+    heap_place(i, entry);
+}
+
+static void heap_sift_down(int i) {
+    HeapEntry entry = ready_queue.heap[i];
+    int count = ready_queue.count;
+    while (1) {
+        int child = 2 * i + 1;
+        if (child >= count) {
+            break;
+        }
+        if (child + 1 < count && heap_less(&ready_queue.heap[child + 1], &ready_queue.heap[child])) {
+            child++;
+        }
+        if (!heap_less(&ready_queue.heap[child], &entry)) {
+            break;
+        }
+        heap_place(i, ready_queue.heap[child]);
+        i = child;
+    }
+    heap_place(i, entry);
+}
+
+// flat -> heap, once the queue outgrows the crossover
+static void queue_flat_to_heap(void) {
+    for (int i = 0; i < ready_queue.count; i++) {
+        HeapEntry entry = { ready_queue.flat_keys[i], ready_queue.flat_procs[i], ready_queue.flat_seqs[i] };
+        heap_place(i, entry);
+    }
+    for (int i = ready_queue.count / 2 - 1; i >= 0; i--) {
+        heap_sift_down(i);
+    }
+    ready_queue.kind = QUEUE_HEAP;
+}
+
+static int compare_seq(const void* a, const void* b) {
+    uint64_t sa = ((const HeapEntry*)a)->seq;
+    uint64_t sb = ((const HeapEntry*)b)->seq;
+    return sa < sb ? -1 : sa > sb;
+}
+
+// heap -> flat, once the queue has shrunk well below the crossover
+static void queue_heap_to_flat(void) {
+    qsort(ready_queue.heap, ready_queue.count, sizeof(HeapEntry), compare_seq);
+    for (int i = 0; i < ready_queue.count; i++) {
+        ready_queue.flat_keys[i] = ready_queue.heap[i].key;
+        ready_queue.flat_procs[i] = ready_queue.heap[i].process;
+        ready_queue.flat_seqs[i] = ready_queue.heap[i].seq;
+    }
+    ready_queue.flat_hint = 0;
+    ready_queue.flat_best_valid = 0;
+    ready_queue.kind = QUEUE_FLAT;
+}
+
+// Double a full ring or heap. A queue sized for the whole table never
+// fills, but a per-CPU queue can, and so can the shared one when the table
+// itself grows (a streaming run's slot pool, lazily generated input).
+static void grow_ready_queue(void) {
+    int capacity = ready_queue.capacity * 2;
+    if (ready_queue.kind == QUEUE_RING) {
+        int* ring = arena_alloc(&arena, sizeof(int) * capacity);
+        for (int i = 0; i < ready_queue.count; i++) {
+            ring[i] = ready_queue_at(i);
+        }
+        ready_queue.ring = ring;
+        ready_queue.head = 0;
+    } else {
+        ready_queue.heap = arena_grow(&arena, ready_queue.heap, sizeof(HeapEntry) * ready_queue.capacity,
+                                      sizeof(HeapEntry) * capacity);
+    }
+    ready_queue.capacity = capacity;
+}
+
+// O(1) for the ring and the flat form, O(log n) for the heap. `key` orders
+// keyed queues (smaller runs first) and is ignored by the ring.
+void enqueue_process(int process, int key) {
+    if (!(processes.flags[process] & (PROCESS_IN_READY_QUEUE | PROCESS_FINISHED))) {
+        if (ready_queue.count == ready_queue.capacity) {
+            grow_ready_queue();
+        }
+        if (ready_queue.kind == QUEUE_FLAT && ready_queue.count == ready_queue.flat_capacity) {
+            queue_flat_to_heap();
+        }
+        if (ready_queue.kind == QUEUE_HEAP) {
+            HeapEntry entry = { key, process, ready_queue.next_seq++ };
+            ready_queue.heap[ready_queue.count] = entry;
+            ready_queue.count++;
+            heap_sift_up(ready_queue.count - 1);
+        } else if (ready_queue.kind == QUEUE_FLAT) {
+            if (ready_queue.count == 0) {
+                ready_queue.flat_best = key;
+                ready_queue.flat_best_valid = 1;
+            } else if (key < ready_queue.flat_best) {
+                ready_queue.flat_best = key; // still the minimum if it was valid
+            }
+            ready_queue.flat_keys[ready_queue.count] = key;
+            ready_queue.flat_procs[ready_queue.count] = process;
+            ready_queue.flat_seqs[ready_queue.count] = ready_queue.next_seq++;
+            ready_queue.count++;
+        } else {
+            int tail = (ready_queue.head + ready_queue.count) % ready_queue.capacity;
+            ready_queue.ring[tail] = process;
+            ready_queue.count++;
+        }
+        processes.flags[process] |= PROCESS_IN_READY_QUEUE;
+    }
+}
+
+// O(1) for the ring when removing the head (always the case in FCFS/RR),
+// O(log n) for the heap, a short memmove for the flat form
+void dequeue_process(int process) {
+    if (!(processes.flags[process] & PROCESS_IN_READY_QUEUE)) {
+        return;
+    }
+    if (ready_queue.kind == QUEUE_HEAP) {
+        int i = processes.queue_index[process];
+        ready_queue.count--;
+        if (i != ready_queue.count) {
+            // move the last entry into the hole and restore heap order
+            HeapEntry moved = ready_queue.heap[ready_queue.count];
+            heap_place(i, moved);
+            heap_sift_up(i);
+            heap_sift_down(processes.queue_index[moved.process]);
+        }
+        if (ready_queue.count < ready_queue.flat_capacity / 2) {
+            queue_heap_to_flat();
+        }
+    } else if (ready_queue.kind == QUEUE_FLAT) {
+        int i = ready_queue.flat_hint;
+        if (i >= ready_queue.count || ready_queue.flat_procs[i] != process) {
+            for (i = 0; ready_queue.flat_procs[i] != process; i++) {
+            }
+        }
+        if (ready_queue.flat_keys[i] == ready_queue.flat_best) {
+            ready_queue.flat_best_valid = 0; // may have been the only minimum
+        }
+        int tail = ready_queue.count - i - 1;
+        memmove(&ready_queue.flat_keys[i], &ready_queue.flat_keys[i + 1], sizeof(int) * tail);
+        memmove(&ready_queue.flat_procs[i], &ready_queue.flat_procs[i + 1], sizeof(int) * tail);
+        memmove(&ready_queue.flat_seqs[i], &ready_queue.flat_seqs[i + 1], sizeof(uint64_t) * tail);
+        ready_queue.count--;
+    } else if (ready_queue.ring[ready_queue.head] == process) {
+        ready_queue.head = (ready_queue.head + 1) % ready_queue.capacity;
+        ready_queue.count--;
+    } else {
+        // not the head, close the gap so FIFO order is kept
+        for (int i = 0; i < ready_queue.count; i++) {
+            if (ready_queue_at(i) == process) {
+                for (int j = i; j < ready_queue.count - 1; j++) {
+                    ready_queue.ring[(ready_queue.head + j) % ready_queue.capacity] = ready_queue_at(j + 1);
+                }
+                ready_queue.count--;
+                break;
+            }
+        }
+    }
+    processes.flags[process] &= ~PROCESS_IN_READY_QUEUE;
+}
+
+// i-th entry in storage order (FIFO order for the ring and the flat form,
+// heap order for the heap)
+int ready_queue_at(int i) {
+    if (ready_queue.kind == QUEUE_HEAP) {
+        return ready_queue.heap[i].process;
+    }
+    if (ready_queue.kind == QUEUE_FLAT) {
+        return ready_queue.flat_procs[i];
+    }
+    return ready_queue.ring[(ready_queue.head + i) % ready_queue.capacity];
+}
+
+// scheduling
+int select_next_process() {
+    if (ready_queue.count == 0) {
+        return -1;
+    }
+
+    // FCFS/RR: head of the ring. SJF/PRIORITY: the shortest remaining time
+    // or highest priority (lowest number), FIFO on ties. That is the top of
+    // the heap, or the first minimum of the key array in the flat form.
+    if (ready_queue.kind == QUEUE_HEAP) {
+        return ready_queue.heap[0].process;
+    }
+    if (ready_queue.kind == QUEUE_FLAT) {
+        ready_queue.flat_hint = argmin_kernel(ready_queue.flat_keys, ready_queue.count);
+        ready_queue.flat_best = ready_queue.flat_keys[ready_queue.flat_hint];
+        ready_queue.flat_best_valid = 1;
+        return ready_queue.flat_procs[ready_queue.flat_hint];
+    }
+    return ready_queue.ring[ready_queue.head];
+}
+
+// Smallest key waiting in a keyed queue, INT_MAX when it is empty. The heap
+// has it on top. The flat form keeps it up to date on enqueue and only
+// rescans after the minimum itself was dequeued, so the per-event
+// preemption test is a single comparison.
+int ready_queue_best_key(void) {
+    if (ready_queue.count == 0) {
+        return INT_MAX;
+    }
+    if (ready_queue.kind == QUEUE_HEAP) {
+        return ready_queue.heap[0].key;
+    }
+    if (!ready_queue.flat_best_valid) {
+        ready_queue.flat_hint = argmin_kernel(ready_queue.flat_keys, ready_queue.count);
+        ready_queue.flat_best = ready_queue.flat_keys[ready_queue.flat_hint];
+        ready_queue.flat_best_valid = 1;
+    }
+    return ready_queue.flat_best;
+}
+
+// Process the cursor-th arrival is
+// rows of the input, which lazily generated input has not all made yet
+static inline int input_rows(void) {
+    return input_lazy ? workload_spec.processes : process_count;
+}
+
+static inline int arrival_row(int cursor) {
+    return arrival_order != NULL ? arrival_order[cursor] : cursor;
+}
+
+// The next arrival is due at current_time
+static inline int arrival_due(void) {
+    if (stream_mode) {
+        return stream.next != -1 && processes.arrival[stream.next] <= current_time;
+    }
+    return arrival_cursor < input_rows() && processes.arrival[arrival_row(arrival_cursor)] <= current_time;
+}
+
+// Take the next arrival. With lazily generated input the row after it is
+// generated now, so its arrival time is there to look at.
+static inline int take_arrival(void) {
+    if (stream_mode) {
+        int process = stream.next;
+        if (++stream.live > stream.peak_live) {
+            stream.peak_live = stream.live;
+        }
+        stream_read();
+        return process;
+    }
+    int process = arrival_row(arrival_cursor++);
+    if (input_lazy && arrival_cursor < workload_spec.processes) {
+        if (arrival_cursor == process_count) {
+            grow_generated();
+        }
+        generate_row(arrival_cursor);
+    }
+    return process;
+}
+
+// earliest arrival not yet admitted, or -1 if nothing else arrives
+int next_arrival_time(void) {
+    if (stream_mode) {
+        return stream.next != -1 ? processes.arrival[stream.next] : -1;
+    }
+    if (arrival_cursor < input_rows()) {
+        return processes.arrival[arrival_row(arrival_cursor)];
+    }
+    return -1;
+}
+
+// scheduling policies
+//
+// FCFS and RR share the ring, SJF, SRTF and PRIORITY the keyed queue. A
+// preempted process goes back to the tail, behind anything that arrived in
+// the same event.
+__thread int rr_quantum_left = 0; // units left in the running process's RR quantum
+
+static int take_next_process(void) {
+    int process = select_next_process();
+    if (process != -1) {
+        dequeue_process(process);
+    }
+    return process;
+}
+
+static void fifo_init(void) {
+    init_ready_queue(QUEUE_RING);
+}
+
+static void fifo_enqueue(int process) {
+    enqueue_process(process, 0);
+}
+
+static void keyed_init(void) {
+    init_ready_queue(QUEUE_FLAT);
+}
+
+static void by_remaining_enqueue(int process) {
+    enqueue_process(process, processes.remaining_time[process]);
+}
+
+static void by_priority_enqueue(int process) {
+    enqueue_process(process, processes.priority[process]);
+}
+
+static int never_preempt(int process) {
+    (void)process;
+    return 0;
+}
+
+static int run_to_completion(int process) {
+    return processes.remaining_time[process];
+}
+
+static void no_tick(int process, int units) {
+    (void)process;
+    (void)units;
+}
+
+static void no_complete(int process) {
+    (void)process;
+}
+
+static void no_grow(int old_count) {
+    (void)old_count; // the ready queue grows on its own
+}
+
+static int rr_select(void) {
+    rr_quantum_left = time_quantum;
+    return take_next_process();
+}
+
+static int rr_should_preempt(int process) {
+    (void)process;
+    return rr_quantum_left <= 0;
+}
+
+static int rr_time_slice(int process) {
+    (void)process;
+    return rr_quantum_left;
+}
+
+static void rr_tick(int process, int units) {
+    (void)process;
+    rr_quantum_left -= units;
+}
+
+static int srtf_should_preempt(int process) {
+    return ready_queue_best_key() < processes.remaining_time[process];
+}
+
+static int priority_should_preempt(int process) {
+    return ready_queue_best_key() < processes.priority[process];
+}
+
+static const SchedulingPolicy fcfs_policy = {
+    "FCFS", fifo_init, fifo_enqueue, take_next_process, never_preempt,
+    fifo_enqueue, run_to_completion, no_tick, no_complete, take_next_process, no_grow
+};
+
+static const SchedulingPolicy sjf_policy = {
+    "SJF", keyed_init, by_remaining_enqueue, take_next_process, never_preempt,
+    by_remaining_enqueue, run_to_completion, no_tick, no_complete, take_next_process, no_grow
+};
+
+static const SchedulingPolicy rr_policy = {
+    "RR", fifo_init, fifo_enqueue, rr_select, rr_should_preempt,
+    fifo_enqueue, rr_time_slice, rr_tick, no_complete, take_next_process, no_grow
+};
+
+static const SchedulingPolicy priority_policy = {
+    "Priority", keyed_init, by_priority_enqueue, take_next_process, priority_should_preempt,
+    by_priority_enqueue, run_to_completion, no_tick, no_complete, take_next_process, no_grow
+};
+
+static const SchedulingPolicy srtf_policy = {
+    "SRTF", keyed_init, by_remaining_enqueue, take_next_process, srtf_should_preempt,
+    by_remaining_enqueue, run_to_completion, no_tick, no_complete, take_next_process, no_grow
+};
+
+// CFS
+//
+// Runnable processes sit in a red-black tree on virtual runtime, and the
+// leftmost one (least vruntime) runs next, so picking is O(1) and
+// inserting/removing O(log n). Running for t units adds t * 1024 / weight
+// to a process's vruntime, where the weight comes from its nice value
+// (the priority column, clamped to -20..19) with the kernel's table. The
+// running process gets a slice of the scheduling period in proportion to
+// its weight. The period is the target latency, stretched to
+// count * min_granularity once there are too many processes to give
+// everyone min_granularity.
+static const uint32_t nice_to_weight[40] = {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */ 9548, 7620, 6100, 4904, 3906,
+    /*  -5 */ 3121, 2501, 1991, 1586, 1277,
+    /*   0 */ 1024, 820, 655, 526, 423,
+    /*   5 */ 335, 272, 215, 172, 137,
+    /*  10 */ 110, 87, 70, 56, 45,
+    /*  15 */ 36, 29, 23, 18, 15
+};
+
+#define CFS_NICE_0_WEIGHT 1024
+
+static int cfs_less(int a, int b) {
+    const CfsNode* na = &cfs.nodes[a];
+    const CfsNode* nb = &cfs.nodes[b];
+    if (na->vruntime != nb->vruntime) {
+        return na->vruntime < nb->vruntime;
+    }
+    return na->seq < nb->seq;
+}
+
+static int cfs_is_red(int n) {
+    return n != -1 && cfs.nodes[n].red;
+}
+
+static void cfs_rotate_left(int x) {
+    CfsNode* nodes = cfs.nodes;
+    int y = nodes[x].right;
+    nodes[x].right = nodes[y].left;
+    if (nodes[y].left != -1) {
+        nodes[nodes[y].left].parent = x;
+    }
+    nodes[y].parent = nodes[x].parent;
+    if (nodes[x].parent == -1) {
+        cfs.root = y;
+    } else if (nodes[nodes[x].parent].left == x) {
+        nodes[nodes[x].parent].left = y;
+    } else {
+        nodes[nodes[x].parent].right = y;
+    }
+    nodes[y].left = x;
+    nodes[x].parent = y;
+}
+
+static void cfs_rotate_right(int x) {
+    CfsNode* nodes = cfs.nodes;
+    int y = nodes[x].left;
+    nodes[x].left = nodes[y].right;
+    if (nodes[y].right != -1) {
+        nodes[nodes[y].right].parent = x;
+    }
+    nodes[y].parent = nodes[x].parent;
+    if (nodes[x].parent == -1) {
+        cfs.root = y;
+    } else if (nodes[nodes[x].parent].right == x) {
+        nodes[nodes[x].parent].right = y;
+    } else {
+        nodes[nodes[x].parent].left = y;
+    }
+    nodes[y].right = x;
+    nodes[x].parent = y;
+}
+
+static void cfs_insert(int z) {
+    CfsNode* nodes = cfs.nodes;
+    int parent = -1;
+    int at = cfs.root;
+    int leftmost = 1;
+    nodes[z].seq = cfs.next_seq++;
+    while (at != -1) {
+        parent = at;
+        if (cfs_less(z, at)) {
+            at = nodes[at].left;
+        } else {
+            at = nodes[at].right;
+            leftmost = 0;
+        }
+    }
+    nodes[z].parent = parent;
+    nodes[z].left = -1;
+    nodes[z].right = -1;
+    nodes[z].red = 1;
+    if (parent == -1) {
+        cfs.root = z;
+    } else if (cfs_less(z, parent)) {
+        nodes[parent].left = z;
+    } else {
+        nodes[parent].right = z;
+    }
+    if (leftmost) {
+        cfs.leftmost = z;
+    }
+    cfs.count++;
+
+    // restore the red-black properties
+    while (cfs_is_red(nodes[z].parent)) {
+        int p = nodes[z].parent;
+        int g = nodes[p].parent;
+        if (p == nodes[g].left) {
+            int uncle = nodes[g].right;
+            if (cfs_is_red(uncle)) {
+                nodes[p].red = 0;
+                nodes[uncle].red = 0;
+                nodes[g].red = 1;
+                z = g;
+                continue;
+            }
+            if (z == nodes[p].right) {
+                z = p;
+                cfs_rotate_left(z);
+                p = nodes[z].parent;
+            }
+            nodes[p].red = 0;
+            nodes[g].red = 1;
+            cfs_rotate_right(g);
+        } else {
+            int uncle = nodes[g].left;
+            if (cfs_is_red(uncle)) {
+                nodes[p].red = 0;
+                nodes[uncle].red = 0;
+                nodes[g].red = 1;
+                z = g;
+                continue;
+            }
+            if (z == nodes[p].left) {
+                z = p;
+                cfs_rotate_right(z);
+                p = nodes[z].parent;
+            }
+            nodes[p].red = 0;
+            nodes[g].red = 1;
+            cfs_rotate_left(g);
+        }
+    }
+    nodes[cfs.root].red = 0;
+}
+
+// put v where u was, as far as u's parent is concerned
+static void cfs_transplant(int u, int v) {
+    CfsNode* nodes = cfs.nodes;
+    int parent = nodes[u].parent;
+    if (parent == -1) {
+        cfs.root = v;
+    } else if (nodes[parent].left == u) {
+        nodes[parent].left = v;
+    } else {
+        nodes[parent].right = v;
+    }
+    if (v != -1) {
+        nodes[v].parent = parent;
+    }
+}
+
+static int cfs_first(int n) {
+    while (cfs.nodes[n].left != -1) {
+        n = cfs.nodes[n].left;
+    }
+    return n;
+}
+
+static void cfs_erase(int z) {
+    CfsNode* nodes = cfs.nodes;
+    if (cfs.leftmost == z) {
+        // the leftmost node has no left child, its successor is the
+        // smallest node on the right or else its parent
+        cfs.leftmost = nodes[z].right != -1 ? cfs_first(nodes[z].right) : nodes[z].parent;
+    }
+    cfs.count--;
+
+    int x, x_parent;
+    int removed_red = nodes[z].red;
+    if (nodes[z].left == -1) {
+        x = nodes[z].right;
+        x_parent = nodes[z].parent;
+        cfs_transplant(z, x);
+    } else if (nodes[z].right == -1) {
+        x = nodes[z].left;
+        x_parent = nodes[z].parent;
+        cfs_transplant(z, x);
+    } else {
+        int y = cfs_first(nodes[z].right);
+        removed_red = nodes[y].red;
+        x = nodes[y].right;
+        if (nodes[y].parent == z) {
+            x_parent = y;
+        } else {
+            x_parent = nodes[y].parent;
+            cfs_transplant(y, x);
+            nodes[y].right = nodes[z].right;
+            nodes[nodes[y].right].parent = y;
+        }
+        cfs_transplant(z, y);
+        nodes[y].left = nodes[z].left;
+        nodes[nodes[y].left].parent = y;
+        nodes[y].red = nodes[z].red;
+    }
+    if (removed_red) {
+        return;
+    }
+
+    // x carries an extra black, push it up or resolve it
+    while (x != cfs.root && !cfs_is_red(x)) {
+        if (x == nodes[x_parent].left) {
+            int w = nodes[x_parent].right;
+            if (cfs_is_red(w)) {
+                nodes[w].red = 0;
+                nodes[x_parent].red = 1;
+                cfs_rotate_left(x_parent);
+                w = nodes[x_parent].right;
+            }
+            if (!cfs_is_red(nodes[w].left) && !cfs_is_red(nodes[w].right)) {
+                nodes[w].red = 1;
+                x = x_parent;
+                x_parent = nodes[x].parent;
+                continue;
+            }
+            if (!cfs_is_red(nodes[w].right)) {
+                nodes[nodes[w].left].red = 0;
+                nodes[w].red = 1;
+                cfs_rotate_right(w);
+                w = nodes[x_parent].right;
+            }
+            nodes[w].red = nodes[x_parent].red;
+            nodes[x_parent].red = 0;
+            nodes[nodes[w].right].red = 0;
+            cfs_rotate_left(x_parent);
+        } else {
+            int w = nodes[x_parent].left;
+            if (cfs_is_red(w)) {
+                nodes[w].red = 0;
+                nodes[x_parent].red = 1;
+                cfs_rotate_right(x_parent);
+                w = nodes[x_parent].left;
+            }
+            if (!cfs_is_red(nodes[w].left) && !cfs_is_red(nodes[w].right)) {
+                nodes[w].red = 1;
+                x = x_parent;
+                x_parent = nodes[x].parent;
+                continue;
+            }
+            if (!cfs_is_red(nodes[w].left)) {
+                nodes[nodes[w].right].red = 0;
+                nodes[w].red = 1;
+                cfs_rotate_left(w);
+                w = nodes[x_parent].left;
+            }
+            nodes[w].red = nodes[x_parent].red;
+            nodes[x_parent].red = 0;
+            nodes[nodes[w].left].red = 0;
+            cfs_rotate_right(x_parent);
+        }
+        x = cfs.root;
+    }
+    if (x != -1) {
+        nodes[x].red = 0;
+    }
+}
+
+// Slice for `process` out of the current scheduling period
+static int cfs_slice(int process) {
+    uint64_t running = cfs.count + 1;
+    uint64_t period = cfs_latency;
+    if (cfs_min_granularity > 0 && running * cfs_min_granularity > period) {
+        period = running * cfs_min_granularity;
+    }
+    uint64_t slice = period * cfs.nodes[process].weight / cfs.total_weight;
+    if (slice < (uint64_t)cfs_min_granularity) {
+        slice = cfs_min_granularity;
+    }
+    if (slice < 1) {
+        slice = 1; // a heavy peer can round a light process's share down to nothing
+    }
+    return slice > INT_MAX ? INT_MAX : (int)slice;
+}
+
+static void cfs_update_min_vruntime(int running) {
+    uint64_t floor = cfs.nodes[running].vruntime;
+    if (cfs.leftmost != -1 && cfs.nodes[cfs.leftmost].vruntime < floor) {
+        floor = cfs.nodes[cfs.leftmost].vruntime;
+    }
+    if (floor > cfs.min_vruntime) {
+        cfs.min_vruntime = floor;
+    }
+}
+
+static void cfs_init(void) {
+    if (policy_instance == 0) {
+        cfs.nodes = arena_alloc(&arena, sizeof(CfsNode) * (process_count + 1));
+    }
+    cfs.root = -1;
+    cfs.leftmost = -1;
+    cfs.count = 0;
+    cfs.total_weight = 0;
+    cfs.min_vruntime = 0;
+    cfs.next_seq = 0;
+    cfs.slice_left = 0;
+}
+
+static void cfs_arrival(int process) {
+    int nice = processes.priority[process];
+    nice = nice < -20 ? -20 : nice > 19 ? 19 : nice;
+    cfs.nodes[process].weight = nice_to_weight[nice + 20];
+    cfs.nodes[process].vruntime = cfs.min_vruntime;
+    cfs.total_weight += cfs.nodes[process].weight;
+    cfs_insert(process);
+}
+
+static int cfs_select(void) {
+    int process = cfs.leftmost;
+    if (process != -1) {
+        cfs_erase(process);
+        cfs.slice_left = cfs_slice(process);
+    }
+    return process;
+}
+
+// Preempt when the slice is used up, or when a waiting process is more
+// than min_granularity (in nice-0 time) behind the running one, as the
+// kernel does on wakeup
+static int cfs_should_preempt(int process) {
+    if (cfs.leftmost == -1) {
+        return 0;
+    }
+    if (cfs.slice_left <= 0) {
+        return 1;
+    }
+    uint64_t granularity = (uint64_t)cfs_min_granularity * CFS_NICE_0_WEIGHT;
+    return cfs.nodes[process].vruntime > cfs.nodes[cfs.leftmost].vruntime + granularity;
+}
+
+static void cfs_preempt(int process) {
+    cfs_insert(process);
+}
+
+static int cfs_time_slice(int process) {
+    if (cfs.slice_left <= 0) {
+        cfs.slice_left = cfs_slice(process); // nobody to switch to, start a new slice
+    }
+    return cfs.slice_left;
+}
+
+static void cfs_tick(int process, int units) {
+    cfs.nodes[process].vruntime += (uint64_t)units * CFS_NICE_0_WEIGHT * CFS_NICE_0_WEIGHT /
+                                   cfs.nodes[process].weight;
+    cfs.slice_left -= units;
+    cfs_update_min_vruntime(process);
+}
+
+static void cfs_complete(int process) {
+    cfs.total_weight -= cfs.nodes[process].weight;
+}
+
+static void cfs_grow(int old_count) {
+    cfs.nodes = arena_grow(&arena, cfs.nodes, sizeof(CfsNode) * (old_count + 1),
+                           sizeof(CfsNode) * (process_count + 1));
+}
+
+// hand the leftmost waiter to another CPU, which admits it afresh
+static int cfs_steal(void) {
+    int process = cfs.leftmost;
+    if (process != -1) {
+        cfs_erase(process);
+        cfs.total_weight -= cfs.nodes[process].weight;
+    }
+    return process;
+}
+
+static const SchedulingPolicy cfs_policy = {
+    "CFS", cfs_init, cfs_arrival, cfs_select, cfs_should_preempt,
+    cfs_preempt, cfs_time_slice, cfs_tick, cfs_complete, cfs_steal, cfs_grow
+};
+
+// MLFQ
+//
+// The O(1) scheduler layout: a FIFO run list per level and a bitmap of
+// non-empty levels, so picking is a find-first-set and a list pop no
+// matter how many processes wait. Arrivals enter the top level. A process
+// that uses up its level's quantum (across however many dispatches) drops
+// a level. One preempted by a higher level keeps what is left. The running
+// process's quantum is RR's rr_quantum_left, with the same expiry
+// handling. Every mlfq_boost time units everything goes back to the top.
+// A boost splices the lower lists onto the top one (O(levels)) and bumps
+// boost_epoch. A process whose epoch is stale is treated as top level
+// with a fresh quantum the next time it is picked, so no process is
+// touched one by one.
+static void mlfq_push(int level, int process) {
+    mlfq.next[process] = -1;
+    if (mlfq.nonempty & (1ull << level)) {
+        mlfq.next[mlfq.tail[level]] = process;
+    } else {
+        mlfq.head[level] = process;
+        mlfq.nonempty |= 1ull << level;
+    }
+    mlfq.tail[level] = process;
+}
+
+static void mlfq_boost_if_due(void) {
+    if (mlfq_boost <= 0 || current_time < mlfq.next_boost) {
+        return;
+    }
+    for (int level = 1; level < mlfq_levels; level++) {
+        if (!(mlfq.nonempty & (1ull << level))) {
+            continue;
+        }
+        if (mlfq.nonempty & 1) {
+            mlfq.next[mlfq.tail[0]] = mlfq.head[level];
+        } else {
+            mlfq.head[0] = mlfq.head[level];
+            mlfq.nonempty |= 1;
+        }
+        mlfq.tail[0] = mlfq.tail[level];
+        mlfq.nonempty &= ~(1ull << level);
+    }
+    mlfq.boost_epoch++;
+    if (mlfq.running != -1) {
+        mlfq.level[mlfq.running] = 0;
+        mlfq.epoch[mlfq.running] = mlfq.boost_epoch;
+    }
+    mlfq.next_boost += mlfq_boost * ((current_time - mlfq.next_boost) / mlfq_boost + 1);
+}
+
+static void mlfq_init(void) {
+    for (int level = 0; level < mlfq_levels; level++) {
+        if (mlfq_quanta[level] == 0) {
+            int above = level == 0 ? time_quantum : mlfq_quanta[level - 1];
+            mlfq_quanta[level] = level == 0 ? (above < 1 ? 1 : above)
+                                            : (above > INT_MAX / 2 ? INT_MAX : above * 2);
+        }
+    }
+    if (policy_instance == 0) {
+        mlfq.next = arena_alloc(&arena, sizeof(int) * (process_count + 1));
+        mlfq.level = arena_alloc(&arena, sizeof(int) * (process_count + 1));
+        mlfq.allotment = arena_alloc(&arena, sizeof(int) * (process_count + 1));
+        mlfq.epoch = arena_alloc(&arena, sizeof(uint32_t) * (process_count + 1));
+    }
+    mlfq.nonempty = 0;
+    mlfq.boost_epoch = 0;
+    mlfq.next_boost = mlfq_boost;
+    mlfq.running = -1;
+}
+
+static void mlfq_arrival(int process) {
+    mlfq.level[process] = 0;
+    mlfq.allotment[process] = mlfq_quanta[0];
+    mlfq.epoch[process] = mlfq.boost_epoch;
+    mlfq_push(0, process);
+}
+
+// take the head of the highest non-empty level
+static int mlfq_pop(void) {
+    if (mlfq.nonempty == 0) {
+        return -1;
+    }
+    int level = __builtin_ctzll(mlfq.nonempty);
+    int process = mlfq.head[level];
+    mlfq.head[level] = mlfq.next[process];
+    if (mlfq.head[level] == -1) {
+        mlfq.nonempty &= ~(1ull << level);
+    }
+    if (mlfq.epoch[process] != mlfq.boost_epoch) {
+        // boosted while waiting
+        mlfq.level[process] = 0;
+        mlfq.allotment[process] = mlfq_quanta[0];
+        mlfq.epoch[process] = mlfq.boost_epoch;
+    }
+    return process;
+}
+
+static int mlfq_select(void) {
+    mlfq_boost_if_due();
+    mlfq.running = mlfq_pop();
+    if (mlfq.running != -1) {
+        rr_quantum_left = mlfq.allotment[mlfq.running];
+    }
+    return mlfq.running;
+}
+
+// Level of a process, 0 if a boost came since it was last leveled. With
+// --balance global the boost only resets the running process of the CPU
+// it fired on; the ones running elsewhere are caught here.
+static inline int mlfq_level_of(int process) {
+    return mlfq.epoch[process] == mlfq.boost_epoch ? mlfq.level[process] : 0;
+}
+
+static int mlfq_should_preempt(int process) {
+    mlfq_boost_if_due();
+    if (rr_quantum_left <= 0) {
+        return 1;
+    }
+    // anything waiting on a higher level
+    return (mlfq.nonempty & ((1ull << mlfq_level_of(process)) - 1)) != 0;
+}
+
+static void mlfq_preempt(int process) {
+    int level = mlfq.level[process];
+    if (mlfq.epoch[process] != mlfq.boost_epoch) {
+        // boosted while running on another CPU: back on top with a fresh quantum
+        level = 0;
+        mlfq.level[process] = 0;
+        mlfq.epoch[process] = mlfq.boost_epoch;
+        mlfq.allotment[process] = mlfq_quanta[0];
+    } else if (rr_quantum_left <= 0) {
+        if (level + 1 < mlfq_levels) {
+            level++;
+        }
+        mlfq.level[process] = level;
+        mlfq.allotment[process] = mlfq_quanta[level];
+    } else {
+        mlfq.allotment[process] = rr_quantum_left;
+    }
+    mlfq.running = -1;
+    mlfq_push(level, process);
+}
+
+static int mlfq_time_slice(int process) {
+    (void)process;
+    if (mlfq_boost > 0 && mlfq.next_boost - current_time < rr_quantum_left) {
+        return mlfq.next_boost - current_time; // wake up for the boost
+    }
+    return rr_quantum_left;
+}
+
+static void mlfq_complete(int process) {
+    (void)process;
+    mlfq.running = -1;
+}
+
+static void mlfq_grow(int old_count) {
+    size_t old_size = old_count + 1;
+    size_t size = process_count + 1;
+    mlfq.next = arena_grow(&arena, mlfq.next, sizeof(int) * old_size, sizeof(int) * size);
+    mlfq.level = arena_grow(&arena, mlfq.level, sizeof(int) * old_size, sizeof(int) * size);
+    mlfq.allotment = arena_grow(&arena, mlfq.allotment, sizeof(int) * old_size, sizeof(int) * size);
+    mlfq.epoch = arena_grow(&arena, mlfq.epoch, sizeof(uint32_t) * old_size, sizeof(uint32_t) * size);
+}
+
+static const SchedulingPolicy mlfq_policy = {
+    "MLFQ", mlfq_init, mlfq_arrival, mlfq_select, mlfq_should_preempt,
+    mlfq_preempt, mlfq_time_slice, rr_tick, mlfq_complete, mlfq_pop, mlfq_grow
+};
+
+// EDF
+//
+// The keyed ready queue on absolute deadline: the earliest deadline runs,
+// FIFO among equal deadlines, and processes without one run only when
+// nothing with a deadline is waiting. Once the queue is past the crossover
+// it is the indexed heap, so an arrival and a pick are each O(log n). An
+// arrival with an earlier deadline than the running process preempts it.
+static void by_deadline_enqueue(int process) {
+    enqueue_process(process, processes.deadline[process]);
+}
+
+static int edf_should_preempt(int process) {
+    return ready_queue_best_key() < processes.deadline[process];
+}
+
+static const SchedulingPolicy edf_policy = {
+    "EDF", keyed_init, by_deadline_enqueue, take_next_process, edf_should_preempt,
+    by_deadline_enqueue, run_to_completion, no_tick, no_complete, take_next_process, no_grow
+};
+
+// Lottery and stride
+//
+// Both take the priority column as a ticket count (at least 1) and give
+// each pick one quantum, with RR's quantum accounting. Lottery draws a
+// ticket uniformly from the pool and runs its holder: the Fenwick tree is
+// walked from the top bit down, one level per step, instead of summing
+// tickets process by process. The draws come from --seed, so a run is
+// reproducible. Stride runs the process with the smallest pass and adds
+// STRIDE_ONE / tickets to its pass per unit run, the deterministic version
+// of the same shares.
+static uint64_t tickets(int process) {
+    int count = processes.priority[process];
+    return count < 1 ? 1 : count > STRIDE_ONE ? STRIDE_ONE : (uint64_t)count;
+}
+
+static uint64_t splitmix64(uint64_t* state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static void lottery_add(int process, int64_t delta) {
+    for (int i = process + 1; i <= lottery.size; i += i & -i) {
+        lottery.tree[i] += delta;
+    }
+    lottery.total += delta;
+}
+
+// Treap over the waiting processes ordered by treap_key(), each node's heap
+// priority a hash of its key
+static inline uint64_t treap_key(int node) {
+    return stream_mode ? stream.row_of[node] : (uint64_t)node;
+}
+
+static uint64_t treap_priority(int node) {
+    uint64_t state = treap_key(node);
+    return splitmix64(&state);
+}
+
+static void treap_update(int node) {
+    lottery.sum[node] = tickets(node);
+    if (lottery.left[node] != -1) {
+        lottery.sum[node] += lottery.sum[lottery.left[node]];
+    }
+    if (lottery.right[node] != -1) {
+        lottery.sum[node] += lottery.sum[lottery.right[node]];
+    }
+}
+
+// the nodes of `node`'s subtree with a key below `key` into *low, the rest into *high
+static void treap_split(int node, uint64_t key, int* low, int* high) {
+    if (node == -1) {
+        *low = *high = -1;
+    } else if (treap_key(node) < key) {
+        treap_split(lottery.right[node], key, &lottery.right[node], high);
+        treap_update(node);
+        *low = node;
+    } else {
+        treap_split(lottery.left[node], key, low, &lottery.left[node]);
+        treap_update(node);
+        *high = node;
+    }
+}
+
+// every key in `low` is below every key in `high`
+static int treap_merge(int low, int high) {
+    if (low == -1 || high == -1) {
+        return low == -1 ? high : low;
+    }
+    if (treap_priority(low) > treap_priority(high)) {
+        lottery.right[low] = treap_merge(lottery.right[low], high);
+        treap_update(low);
+        return low;
+    }
+    lottery.left[high] = treap_merge(low, lottery.left[high]);
+    treap_update(high);
+    return high;
+}
+
+// Walk down to where the process's priority puts it, counting its tickets
+// into the subtrees passed on the way, and split what is there under it
+static void treap_insert(int process) {
+    uint64_t key = treap_key(process);
+    uint64_t priority = treap_priority(process);
+    int* link = &lottery.root;
+    while (*link != -1 && treap_priority(*link) > priority) {
+        lottery.sum[*link] += tickets(process);
+        link = treap_key(*link) < key ? &lottery.right[*link] : &lottery.left[*link];
+    }
+    treap_split(*link, key, &lottery.left[process], &lottery.right[process]);
+    treap_update(process);
+    *link = process;
+}
+
+// The reverse: take the tickets out on the way down, then its children
+// take its place
+static void treap_remove(int process) {
+    uint64_t key = treap_key(process);
+    int* link = &lottery.root;
+    while (*link != process) {
+        lottery.sum[*link] -= tickets(process);
+        link = treap_key(*link) < key ? &lottery.right[*link] : &lottery.left[*link];
+    }
+    *link = treap_merge(lottery.left[process], lottery.right[process]);
+}
+
+// holder of the ticket-th ticket, in key order
+static int treap_find(uint64_t ticket) {
+    int node = lottery.root;
+    while (1) {
+        int left = lottery.left[node];
+        if (left != -1 && ticket < lottery.sum[left]) {
+            node = left;
+            continue;
+        }
+        if (left != -1) {
+            ticket -= lottery.sum[left];
+        }
+        if (ticket < tickets(node)) {
+            return node;
+        }
+        ticket -= tickets(node);
+        node = lottery.right[node];
+    }
+}
+
+static void lottery_init(void) {
+    lottery.total = 0;
+    lottery.rng = seed;
+    if (policy_instance > 0) {
+        // every CPU draws its own sequence, the first the one of a single pool
+        uint64_t state = seed ^ ((uint64_t)policy_instance * 0xd1b54a32d192ed03ull);
+        lottery.rng = splitmix64(&state);
+    }
+    lottery.use_treap = stream_mode || run_queue_capacity > 0;
+    if (lottery.use_treap) {
+        if (policy_instance == 0) {
+            lottery.left = arena_alloc(&arena, sizeof(int) * (process_count + 1));
+            lottery.right = arena_alloc(&arena, sizeof(int) * (process_count + 1));
+            lottery.sum = arena_alloc(&arena, sizeof(uint64_t) * (process_count + 1));
+        }
+        lottery.root = -1;
+        return;
+    }
+    lottery.size = process_count;
+    lottery.tree = arena_alloc(&arena, sizeof(uint64_t) * (process_count + 1));
+    memset(lottery.tree, 0, sizeof(uint64_t) * (process_count + 1));
+    lottery.top_bit = 1;
+    while (lottery.top_bit * 2 <= lottery.size) {
+        lottery.top_bit *= 2;
+    }
+}
+
+static void lottery_arrival(int process) {
+    if (lottery.use_treap) {
+        treap_insert(process);
+        lottery.total += tickets(process);
+        return;
+    }
+    lottery_add(process, tickets(process));
 }
 
-void run_scheduler(void) {
+static int lottery_draw(void) {
+    if (lottery.total == 0) {
+        return -1;
+    }
+    // winning ticket in [0, total), then the process whose range holds it
+    uint64_t ticket = (uint64_t)(((unsigned __int128)splitmix64(&lottery.rng) * lottery.total) >> 64);
+    if (lottery.use_treap) {
+        int process = treap_find(ticket);
+        treap_remove(process);
+        lottery.total -= tickets(process);
+        return process;
+    }
+    int at = 0;
+    for (int step = lottery.top_bit; step > 0; step /= 2) {
+        if (at + step <= lottery.size && lottery.tree[at + step] <= ticket) {
+            at += step;
+            ticket -= lottery.tree[at];
+        }
+    }
+    lottery_add(at, -(int64_t)tickets(at));
+    return at;
+}
+
+// Nodes up to old_count keep their ranges. Each new node covers a range
+// that only reaches back into the old ones, so its sum is a difference of
+// two prefix sums of the old tree.
+static void lottery_grow(int old_count) {
+    if (lottery.use_treap) {
+        size_t old_size = old_count + 1;
+        size_t size = process_count + 1;
+        lottery.left = arena_grow(&arena, lottery.left, sizeof(int) * old_size, sizeof(int) * size);
+        lottery.right = arena_grow(&arena, lottery.right, sizeof(int) * old_size, sizeof(int) * size);
+        lottery.sum = arena_grow(&arena, lottery.sum, sizeof(uint64_t) * old_size, sizeof(uint64_t) * size);
+        return;
+    }
+    uint64_t* tree = arena_alloc(&arena, sizeof(uint64_t) * (process_count + 1));
+    memcpy(tree, lottery.tree, sizeof(uint64_t) * (old_count + 1));
+    for (int i = old_count + 1; i <= process_count; i++) {
+        int low = i - (i & -i);
+        uint64_t below = 0;
+        for (int j = low; j > 0; j -= j & -j) {
+            below += lottery.tree[j];
+        }
+        tree[i] = low < old_count ? lottery.total - below : 0;
+    }
+    lottery.tree = tree;
+    lottery.size = process_count;
+    while (lottery.top_bit * 2 <= lottery.size) {
+        lottery.top_bit *= 2;
+    }
+}
+
+static int lottery_select(void) {
+    rr_quantum_left = time_quantum;
+    return lottery_draw();
+}
+
+static const SchedulingPolicy lottery_policy = {
+    "Lottery", lottery_init, lottery_arrival, lottery_select, rr_should_preempt,
+    lottery_arrival, rr_time_slice, rr_tick, no_complete, lottery_draw, lottery_grow
+};
+
+static int stride_less(const StrideEntry* a, const StrideEntry* b) {
+    if (a->pass != b->pass) {
+        return a->pass < b->pass;
+    }
+    return a->seq < b->seq;
+}
+
+static void stride_push(int process) {
+    if (stride.count == stride.capacity) {
+        stride.heap = arena_grow(&arena, stride.heap, sizeof(StrideEntry) * stride.capacity,
+                                 sizeof(StrideEntry) * stride.capacity * 2);
+        stride.capacity *= 2;
+    }
+    StrideEntry entry = { stride.pass[process], stride.next_seq++, process };
+    int i = stride.count++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!stride_less(&entry, &stride.heap[parent])) {
+            break;
+        }
+        stride.heap[i] = stride.heap[parent];
+        i = parent;
+    }
+    stride.heap[i] = entry;
+}
+
+static void stride_init(void) {
+    stride.capacity = run_queue_capacity > 0 ? run_queue_capacity : process_count + 1;
+    stride.heap = arena_alloc(&arena, sizeof(StrideEntry) * stride.capacity);
+    if (policy_instance == 0) {
+        stride.pass = arena_alloc(&arena, sizeof(uint64_t) * (process_count + 1));
+    }
+    stride.count = 0;
+    stride.min_pass = 0;
+    stride.next_seq = 0;
+}
+
+static void stride_grow(int old_count) {
+    stride.pass = arena_grow(&arena, stride.pass, sizeof(uint64_t) * (old_count + 1),
+                             sizeof(uint64_t) * (process_count + 1));
+}
+
+static void stride_arrival(int process) {
+    stride.pass[process] = stride.min_pass;
+    stride_push(process);
+}
+
+static int stride_pop(void) {
+    if (stride.count == 0) {
+        return -1;
+    }
+    int process = stride.heap[0].process;
+    StrideEntry last = stride.heap[--stride.count];
+    int i = 0;
+    while (1) {
+        int child = 2 * i + 1;
+        if (child >= stride.count) {
+            break;
+        }
+        if (child + 1 < stride.count && stride_less(&stride.heap[child + 1], &stride.heap[child])) {
+            child++;
+        }
+        if (!stride_less(&stride.heap[child], &last)) {
+            break;
+        }
+        stride.heap[i] = stride.heap[child];
+        i = child;
+    }
+    stride.heap[i] = last;
+    return process;
+}
+
+static int stride_select(void) {
+    rr_quantum_left = time_quantum;
+    return stride_pop();
+}
+
+static void stride_tick(int process, int units) {
+    rr_quantum_left -= units;
+    stride.pass[process] += (uint64_t)units * (STRIDE_ONE / tickets(process));
+    uint64_t floor = stride.pass[process];
+    if (stride.count > 0 && stride.heap[0].pass < floor) {
+        floor = stride.heap[0].pass;
+    }
+    if (floor > stride.min_pass) {
+        stride.min_pass = floor;
+    }
+}
+
+static const SchedulingPolicy stride_policy = {
+    "Stride", stride_init, stride_arrival, stride_select, rr_should_preempt,
+    stride_push, rr_time_slice, stride_tick, no_complete, stride_pop, stride_grow
+};
+
+// Every process has finished. A streaming run does not know how many there
+// are, it is done once the input is and nothing is live.
+static inline int all_finished(int finished) {
+    if (stream_mode) {
+        return stream.next == -1 && stream.live == 0;
+    }
+    return finished == input_rows();
+}
+
+// The scheduler loop, written once against the policy hooks. Always inlined
+// into a per-policy run function where `policy` is a constant, so the hook
+// calls become direct (and mostly inlined) calls.
+static inline __attribute__((always_inline)) void scheduler_loop(const SchedulingPolicy* policy) {
     int processes_finished = 0;
-    Process *current_running = NULL;
-    int quantum_remaining = 0;
+    int current_running = -1;
     int cpu_busy_cycles = 0;
     int execution_start = -1;
 
-    // Continue until all processes finish
-    while (processes_finished < process_count) {
-        pthread_mutex_lock(&scheduler_mutex);
+    policy->init();
+    run_metrics = new_run_metrics();
+    // allocated last so it can keep growing in place
+    gantt_lane_init(&gantt_chart, gantt_capacity);
+
+    // The clock is event driven: instead of one pass per time unit, each pass
+    // handles everything that happens at current_time and then jumps straight
+    // to the next event. Events are an arrival, a completion, the end of a
+    // quantum or slice (RR, lottery, stride, MLFQ, CFS) and an MLFQ priority
+    // boost, which time_slice cuts the slice short for. Any but a completion
+    // can preempt, so should_preempt is asked on every pass.
+    // Continue until all processes finish
+    while (!all_finished(processes_finished)) {
+        if (engine == ENGINE_THREADED) {
+            pthread_mutex_lock(&scheduler_mutex);
+        }
+
+        // Step 1: Admit arrivals at current_time
+        while (arrival_due()) {
+            policy->on_arrival(take_arrival());
+        }
+
+
+        // STEP 2: Now check for preemption after arrivals
+        int running_finished = current_running != -1 &&
+                               (processes.flags[current_running] & PROCESS_FINISHED);
+        if (current_running != -1 && !running_finished && policy->should_preempt(current_running)) {
+            // Record partial execution in Gantt chart
+            if (execution_start != -1) {
+                add_gantt_entry(current_running, execution_start, current_time);
+            }
+            
+            policy->on_preempt(current_running);
+            current_running = -1;
+            execution_start = -1;
+        }
+
+
+
+        // STEP 3: Select next process if needed
+        if (current_running == -1 || running_finished) {
+            if (running_finished) {
+                // Record finished process in Gantt
+                if (execution_start != -1) {
+                    add_gantt_entry(current_running, execution_start, current_time);
+                }
+                policy->on_complete(current_running);
+                record_completion(current_running);
+                processes_finished++;
+                if (stream_mode) {
+                    retire_process(current_running);
+                }
+            }
+            
+            current_running = policy->select();
+            
+            if (current_running != -1) {
+
+                if (processes.start_time[current_running] == -1) {
+                    processes.start_time[current_running] = current_time;
+                }
+                execution_start = current_time;
+            }
+        }
+
+        // STEP 4: Run until the next event
+        int next_arrival = next_arrival_time();
+        int elapsed = 0;
+        if (current_running != -1 && !all_finished(processes_finished)) {
+            // Run to completion unless the policy's slice or an arrival comes first
+            int slice = processes.remaining_time[current_running];
+            int limit = policy->time_slice(current_running);
+            if (limit < slice) {
+                slice = limit;
+            }
+            if (next_arrival != -1 && next_arrival - current_time < slice) {
+                slice = next_arrival - current_time;
+            }
+            cpu_busy_cycles += slice;
+            
+            if (engine == ENGINE_THREADED) {
+                // Dispatch for the whole slice in one handoff
+                process_threads[current_running].run_units = slice;
+                process_threads[current_running].run_start = current_time;
+                pthread_mutex_unlock(&scheduler_mutex);
+                sem_post(&process_threads[current_running].semaphore);
+                sem_wait(&scheduler_sem);
+            } else {
+                execute_process(current_running, current_time, slice);
+            }
+            
+            policy->on_tick(current_running, slice);
+            elapsed = slice;
+            
+        } else {
+            // CPU idle until the next arrival
+            if (engine == ENGINE_THREADED) {
+                pthread_mutex_unlock(&scheduler_mutex);
+            }
+            if (!all_finished(processes_finished)) {
+                if (next_arrival == -1) {
+                    break; // nothing left that can ever arrive
+                }
+                elapsed = next_arrival - current_time;
+            }
+        }
+
+        // STEP 5: Advance clock to the next event (only if we have not finished yet)
+        if (!all_finished(processes_finished)) {
+            current_time += elapsed; // this fixes issue with less than 100% utilization issue
+        }
+    }
+    
+    // Calculate actual CPU utilization
+    cpu_utilization = current_time > 0 ? (float)cpu_busy_cycles / current_time * 100.0 : 0.0;
+    // Store for later printing
+}
+
+#define POLICY_LOOP(name) \
+    static void run_##name(void) { scheduler_loop(&name##_policy); }
+
+POLICY_LOOP(fcfs)
+POLICY_LOOP(sjf)
+POLICY_LOOP(rr)
+POLICY_LOOP(priority)
+POLICY_LOOP(srtf)
+POLICY_LOOP(cfs)
+POLICY_LOOP(mlfq)
+POLICY_LOOP(edf)
+POLICY_LOOP(lottery)
+POLICY_LOOP(stride)
+
+// Policies by SchedulingAlgorithm, with their specialized loops, the
+// option naming them and whether -q changes what they do
+static const struct {
+    const SchedulingPolicy* policy;
+    void (*run)(void);
+    const char* option;
+    int uses_quantum;
+} policy_table[] = {
+    [FCFS] = { &fcfs_policy, run_fcfs, "fcfs", 0 },
+    [SJF] = { &sjf_policy, run_sjf, "sjf", 0 },
+    [RR] = { &rr_policy, run_rr, "rr", 1 },
+    [PRIORITY] = { &priority_policy, run_priority, "priority", 0 },
+    [SRTF] = { &srtf_policy, run_srtf, "srtf", 0 },
+    [CFS] = { &cfs_policy, run_cfs, "cfs", 0 },
+    [MLFQ] = { &mlfq_policy, run_mlfq, "mlfq", 1 },
+    [EDF] = { &edf_policy, run_edf, "edf", 0 },
+    [LOTTERY] = { &lottery_policy, run_lottery, "lottery", 1 },
+    [STRIDE] = { &stride_policy, run_stride, "stride", 1 },
+};
+
+// multiple CPUs
+//
+// Every CPU runs the same policy. With BALANCE_GLOBAL they all dispatch
+// from the one ready queue. With BALANCE_STEAL each has its own run queue:
+// an arrival goes to the least loaded CPU, and at balance points (arrivals
+// and every balance_interval units) an idle CPU with nothing queued steals
+// one waiting process from the CPU with the most. Between balance points
+// the CPUs never touch each other's state.
+//
+// Each CPU runs the single CPU loop's steps on its own events, and slices
+// are still cut at arrivals, so every running CPU gets to check for
+// preemption when something arrives. With a global queue all CPUs step
+// through every event together (run_lockstep). With stealing they only
+// meet at balance points and run in parallel between them (run_epochs).
+static void cpu_enter(Cpu* cpu) {
+    if (balance == BALANCE_STEAL) {
+        ready_queue = cpu->policy.ready_queue;
+        cfs = cpu->policy.cfs;
+        mlfq = cpu->policy.mlfq;
+        lottery = cpu->policy.lottery;
+        stride = cpu->policy.stride;
+    } else {
+        cfs.slice_left = cpu->policy.cfs.slice_left;
+        mlfq.running = cpu->policy.mlfq.running;
+    }
+    rr_quantum_left = cpu->policy.rr_quantum_left;
+}
+
+static void cpu_leave(Cpu* cpu) {
+    if (balance == BALANCE_STEAL) {
+        cpu->policy.ready_queue = ready_queue;
+        cpu->policy.cfs = cfs;
+        cpu->policy.mlfq = mlfq;
+        cpu->policy.lottery = lottery;
+        cpu->policy.stride = stride;
+    } else {
+        cpu->policy.cfs.slice_left = cfs.slice_left;
+        cpu->policy.mlfq.running = mlfq.running;
+    }
+    cpu->policy.rr_quantum_left = rr_quantum_left;
+}
+
+static void add_lane_entry(Cpu* cpu, int process, int start, int end) {
+    gantt_append(&cpu->gantt, processes.pid_id[process], start, end);
+}
+
+// Route an arrival: the shared queue, or the CPU with the fewest processes
+// (waiting plus running), lowest number on ties
+static void route_arrival(const SchedulingPolicy* policy, int process) {
+    if (balance == BALANCE_GLOBAL) {
+        policy->on_arrival(process);
+        return;
+    }
+    int target = 0;
+    int target_load = INT_MAX;
+    for (int c = 0; c < cpu_count; c++) {
+        int load = cpus[c].waiting + (cpus[c].running != -1);
+        if (load < target_load) {
+            target = c;
+            target_load = load;
+        }
+    }
+    cpu_enter(&cpus[target]);
+    policy->on_arrival(process);
+    cpu_leave(&cpus[target]);
+    cpus[target].waiting++;
+}
+
+// Every idle CPU with an empty run queue takes one process from the CPU
+// with the most waiting. The stolen process is admitted to the thief's run
+// queue as an arrival.
+static void balance_cpus(const SchedulingPolicy* policy) {
+    for (int thief = 0; thief < cpu_count; thief++) {
+        if (cpus[thief].running != -1 || cpus[thief].waiting > 0) {
+            continue;
+        }
+        int victim = -1;
+        for (int c = 0; c < cpu_count; c++) {
+            if (cpus[c].waiting > 0 && (victim == -1 || cpus[c].waiting > cpus[victim].waiting)) {
+                victim = c;
+            }
+        }
+        if (victim == -1) {
+            return; // nothing waits anywhere
+        }
+        cpu_enter(&cpus[victim]);
+        int process = policy->steal();
+        cpu_leave(&cpus[victim]);
+        if (process == -1) {
+            continue;
+        }
+        cpus[victim].waiting--;
+        cpu_enter(&cpus[thief]);
+        policy->on_arrival(process);
+        cpu_leave(&cpus[thief]);
+        cpus[thief].waiting++;
+    }
+}
+
+// Dispatch onto an idle CPU, if its queue has anything
+static void cpu_dispatch(const SchedulingPolicy* policy, int c) {
+    Cpu* cpu = &cpus[c];
+    cpu->running = policy->select();
+    if (cpu->running == -1) {
+        return;
+    }
+    cpu->waiting--;
+    if (processes.start_time[cpu->running] == -1) {
+        processes.start_time[cpu->running] = current_time;
+    }
+    if (last_cpu[cpu->running] != -1 && last_cpu[cpu->running] != c) {
+        cpu->migrations++;
+    }
+    last_cpu[cpu->running] = c;
+    cpu->execution_start = current_time;
+    cpu->slice_end = current_time; // its slice is cut below
+}
+
+// The part of one scheduler pass that happens on one CPU, in the single
+// CPU loop's order: retire a finished process, dispatch if idle, or check
+// the running one for preemption. Returns 1 if a process finished.
+static int cpu_event(const SchedulingPolicy* policy, int c) {
+    Cpu* cpu = &cpus[c];
+    int finished = 0;
+    cpu_enter(cpu);
+    // (a process dispatched in this pass is not checked again, its
+    // execution_start is now and every slice is at least one unit)
+    if (cpu->running != -1 && cpu->slice_end == current_time && cpu->execution_start != current_time) {
+        int process = cpu->running;
+        if (processes.flags[process] & PROCESS_FINISHED) {
+            add_lane_entry(cpu, process, cpu->execution_start, current_time);
+            policy->on_complete(process);
+            record_completion(process);
+            cpu->running = -1;
+            cpu->last_finish = current_time;
+            finished = 1;
+            cpu_dispatch(policy, c);
+        } else if (policy->should_preempt(process)) {
+            add_lane_entry(cpu, process, cpu->execution_start, current_time);
+            policy->on_preempt(process);
+            cpu->waiting++;
+            cpu->running = -1;
+            cpu_dispatch(policy, c);
+        }
+    } else if (cpu->running == -1) {
+        cpu_dispatch(policy, c);
+    }
+    cpu_leave(cpu);
+    return finished;
+}
+
+// Run the CPU's process until its next event: the end of its slice, the
+// end of its work or the next arrival, whichever is first
+static void cpu_run_slice(const SchedulingPolicy* policy, int c, int next_arrival) {
+    Cpu* cpu = &cpus[c];
+    if (cpu->running == -1 || cpu->slice_end != current_time) {
+        return;
+    }
+    cpu_enter(cpu);
+    int slice = processes.remaining_time[cpu->running];
+    int limit = policy->time_slice(cpu->running);
+    if (limit < slice) {
+        slice = limit;
+    }
+    if (next_arrival != -1 && next_arrival - current_time < slice) {
+        slice = next_arrival - current_time;
+    }
+    execute_process(cpu->running, current_time, slice);
+    policy->on_tick(cpu->running, slice);
+    cpu->busy += slice;
+    cpu->slice_end = current_time + slice;
+    cpu_leave(cpu);
+}
+
+// Admit the arrivals due at current_time. Returns 1 if there were any.
+static int admit_arrivals(const SchedulingPolicy* policy) {
+    int arrived = 0;
+    while (arrival_due()) {
+        route_arrival(policy, take_arrival());
+        arrived = 1;
+    }
+    return arrived;
+}
+
+// Idle CPUs dispatch first, so an arrival goes to an idle CPU rather than
+// preempting a busy one
+static void dispatch_idle_cpus(const SchedulingPolicy* policy) {
+    for (int c = 0; c < cpu_count; c++) {
+        if (cpus[c].running == -1) {
+            cpu_enter(&cpus[c]);
+            cpu_dispatch(policy, c);
+            cpu_leave(&cpus[c]);
+        }
+    }
+}
+
+// BALANCE_GLOBAL: every dispatch goes through the shared queue, so all CPUs
+// step through every event together
+static void run_lockstep(const SchedulingPolicy* policy) {
+    int processes_finished = 0;
+    while (processes_finished < process_count) {
+        // Step 1: Admit arrivals at current_time
+        admit_arrivals(policy);
+
+        // Step 2: Idle CPUs dispatch
+        dispatch_idle_cpus(policy);
+
+        // Step 3: Retire, preempt and redispatch on CPUs with an event now
+        for (int c = 0; c < cpu_count; c++) {
+            processes_finished += cpu_event(policy, c);
+        }
+        if (processes_finished == process_count) {
+            break;
+        }
+        // a preemption may have queued work a CPU already passed over
+        dispatch_idle_cpus(policy);
+
+        // Step 4: Start the slices of CPUs that need one
+        int next_arrival = next_arrival_time();
+        for (int c = 0; c < cpu_count; c++) {
+            cpu_run_slice(policy, c, next_arrival);
+        }
+
+        // Step 5: Advance the clock to the earliest next event
+        int next = next_arrival != -1 ? next_arrival : INT_MAX;
+        for (int c = 0; c < cpu_count; c++) {
+            if (cpus[c].running != -1 && cpus[c].slice_end < next) {
+                next = cpus[c].slice_end;
+            }
+        }
+        if (next == INT_MAX) {
+            break; // nothing left that can ever arrive
+        }
+        current_time = next;
+    }
+}
+
+// BALANCE_STEAL runs in epochs. CPUs only interact at arrivals and steals,
+// so between two of those each CPU can be advanced on its own, and the
+// CPUs are split over host threads that meet at a barrier at the end of
+// each epoch. Thread 0 then does the cross-core work (routing arrivals,
+// stealing) alone and sets the next horizon: the next arrival, or the next
+// balance tick if anything is waiting (an empty run queue cannot fill up
+// between arrivals, so with nothing waiting no steal can happen before one).
+// Each CPU goes through the same steps in the same order as it would in
+// the lockstep loop, so results do not depend on the number of threads.
+static int run_epoch(HostThread* host) {
+    const Epoch* epoch = host->epoch;
+    int finished = 0;
+    for (int c = host->first_cpu; c < host->cpu_end; c++) {
+        Cpu* cpu = &cpus[c];
+        current_time = epoch->start;
+        while (1) {
+            finished += cpu_event(epoch->policy, c);
+            cpu_run_slice(epoch->policy, c, epoch->next_arrival);
+            if (cpu->running == -1 || cpu->slice_end >= epoch->horizon) {
+                break; // idle until the next epoch, or its next event is in it
+            }
+            current_time = cpu->slice_end;
+        }
+    }
+    return finished;
+}
+
+static void* host_thread(void* arg) {
+    HostThread* host = (HostThread*)arg;
+    Epoch* epoch = host->epoch;
+    arena_init(&arena, ARENA_MIN_BLOCK);
+    adopt_run_state(&epoch->run);
+    run_metrics = new_run_metrics();
+    while (1) {
+        pthread_barrier_wait(&epoch->begin);
+        if (epoch->done) {
+            break;
+        }
+        host->finished = run_epoch(host);
+        pthread_barrier_wait(&epoch->end);
+    }
+    host->arena = arena;
+    host->metrics = run_metrics;
+    return NULL;
+}
+
+static void run_epochs(const SchedulingPolicy* policy) {
+    Epoch epoch;
+    int hosts = host_thread_count < cpu_count ? host_thread_count : cpu_count;
+    epoch.hosts = hosts;
+    host_threads = arena_alloc(&arena, sizeof(HostThread) * hosts);
+    memset(host_threads, 0, sizeof(HostThread) * hosts);
+    host_threads_used = hosts;
+    save_run_state(&epoch.run);
+    for (int k = 0; k < hosts; k++) {
+        host_threads[k].epoch = &epoch;
+        host_threads[k].first_cpu = (int)((long long)cpu_count * k / hosts);
+        host_threads[k].cpu_end = (int)((long long)cpu_count * (k + 1) / hosts);
+    }
+    epoch.policy = policy;
+    epoch.done = 0;
+    if (hosts > 1) {
+        pthread_barrier_init(&epoch.begin, NULL, hosts);
+        pthread_barrier_init(&epoch.end, NULL, hosts);
+        for (int k = 1; k < hosts; k++) {
+            pthread_create(&host_threads[k].thread, NULL, host_thread, &host_threads[k]);
+        }
+    }
+
+    int processes_finished = 0;
+    int epochs = 0;
+    while (1) {
+        // cross-core work at the start of the epoch
+        int arrived = admit_arrivals(policy);
+        dispatch_idle_cpus(policy);
+        if (arrived || current_time % balance_interval == 0) {
+            balance_cpus(policy); // thieves dispatch at the start of the epoch
+        }
+        int next_arrival = next_arrival_time();
+        int queued = 0;
+        for (int c = 0; c < cpu_count; c++) {
+            queued |= cpus[c].waiting > 0;
+        }
+        epoch.start = current_time;
+        epoch.next_arrival = next_arrival;
+        epoch.horizon = next_arrival != -1 ? next_arrival : INT_MAX;
+        if (queued && current_time / balance_interval + 1 <= (INT_MAX - 1) / balance_interval) {
+            int tick = (current_time / balance_interval + 1) * balance_interval;
+            if (tick < epoch.horizon) {
+                epoch.horizon = tick;
+            }
+        }
+
+        // every CPU advances to the horizon
+        if (hosts > 1) {
+            pthread_barrier_wait(&epoch.begin);
+        }
+        host_threads[0].finished = run_epoch(&host_threads[0]);
+        if (hosts > 1) {
+            pthread_barrier_wait(&epoch.end);
+        }
+        current_time = epoch.start; // run_epoch moved thread 0's clock
+        epochs++;
+
+        for (int k = 0; k < hosts; k++) {
+            processes_finished += host_threads[k].finished;
+        }
+        if (processes_finished == process_count || epoch.horizon == INT_MAX) {
+            break;
+        }
+        current_time = epoch.horizon;
+    }
+
+    if (hosts > 1) {
+        epoch.done = 1;
+        pthread_barrier_wait(&epoch.begin);
+        for (int k = 1; k < hosts; k++) {
+            pthread_join(host_threads[k].thread, NULL);
+            merge_run_metrics(run_metrics, host_threads[k].metrics);
+        }
+        pthread_barrier_destroy(&epoch.begin);
+        pthread_barrier_destroy(&epoch.end);
+    }
+    // the run ends when the last process finishes
+    current_time = 0;
+    for (int c = 0; c < cpu_count; c++) {
+        if (cpus[c].last_finish > current_time) {
+            current_time = cpus[c].last_finish;
+        }
+    }
+    if (show_stats) {
+        fprintf(stderr, "Simulated %d CPUs on %d host thread%s in %d epoch%s\n", cpu_count,
+                hosts, hosts == 1 ? "" : "s", epochs, epochs == 1 ? "" : "s");
+    }
+}
+
+void run_multicore(void) {
+    const SchedulingPolicy* policy = policy_table[algorithm].policy;
+    cpus = arena_alloc(&arena, sizeof(Cpu) * cpu_count);
+    memset(cpus, 0, sizeof(Cpu) * cpu_count);
+    run_metrics = new_run_metrics();
+    last_cpu = arena_alloc(&arena, sizeof(int) * (process_count + 1));
+    for (int i = 0; i < process_count; i++) {
+        last_cpu[i] = -1;
+    }
+
+    // One run queue per CPU, each starting at its share of the processes
+    // and sharing the per-process columns of the first, or one for all
+    if (balance == BALANCE_STEAL) {
+        run_queue_capacity = process_count / cpu_count + 16;
+        for (int c = 0; c < cpu_count; c++) {
+            policy_instance = c;
+            policy->init();
+            cpu_leave(&cpus[c]);
+        }
+        policy_instance = 0;
+        run_queue_capacity = 0;
+    } else {
+        policy->init();
+        for (int c = 0; c < cpu_count; c++) {
+            cpu_leave(&cpus[c]);
+        }
+    }
+    for (int c = 0; c < cpu_count; c++) {
+        cpus[c].running = -1;
+        gantt_lane_init(&cpus[c].gantt, gantt_capacity / cpu_count + 16);
+    }
+
+    if (balance == BALANCE_STEAL) {
+        run_epochs(policy);
+    } else {
+        run_lockstep(policy);
+    }
+
+    long long busy = 0;
+    for (int c = 0; c < cpu_count; c++) {
+        busy += cpus[c].busy;
+    }
+    cpu_utilization = current_time > 0 ? (float)busy / ((double)current_time * cpu_count) * 100.0 : 0.0;
+}
+
+void run_scheduler(void) {
+    if (cpu_count > 1) {
+        run_multicore();
+        return;
+    }
+    policy_table[algorithm].run();
+}
+
+// parameter sweep
+//
+// Every combination of the --sweep algorithms and the --sweep-quanta range
+// runs on a pool of worker threads. The loaded table is shared: a worker
+// adopts it, points the per-run columns at its own copies and runs the
+// scheduler as usual, since all the state a run touches is per thread.
+// Policies that ignore the quantum run once.
+
+// Comma separated policy names, as the options spell them, or "all"
+int parse_sweep_list(const char* list) {
+    if (strcmp(list, "all") == 0) {
+        for (int a = 0; a <= STRIDE; a++) {
+            sweep_algorithms[a] = (SchedulingAlgorithm)a;
+        }
+        sweep_count = STRIDE + 1;
+        return 1;
+    }
+    sweep_count = 0;
+    const char* at = list;
+    while (*at != '\0') {
+        const char* end = strchr(at, ',');
+        size_t len = end != NULL ? (size_t)(end - at) : strlen(at);
+        int found = -1;
+        for (int a = 0; a <= STRIDE; a++) {
+            if (strlen(policy_table[a].option) == len && strncmp(policy_table[a].option, at, len) == 0) {
+                found = a;
+            }
+        }
+        if (found == -1) {
+            return 0;
+        }
+        int seen = 0;
+        for (int i = 0; i < sweep_count; i++) {
+            seen |= sweep_algorithms[i] == (SchedulingAlgorithm)found;
+        }
+        if (!seen) {
+            sweep_algorithms[sweep_count++] = (SchedulingAlgorithm)found;
+        }
+        at = end != NULL ? end + 1 : at + len;
+    }
+    return sweep_count > 0;
+}
+
+// first[:last[:step]], a single value sweeps just that quantum
+int parse_quantum_range(const char* range) {
+    long values[3] = { 0, 0, 1 };
+    const char* at = range;
+    int fields = 0;
+    do {
+        char* end;
+        values[fields] = strtol(at, &end, 10);
+        if (end == at || values[fields] < 1 || values[fields] > INT_MAX || (*end != ':' && *end != '\0')) {
+            return 0;
+        }
+        fields++;
+        at = *end == ':' ? end + 1 : end;
+    } while (*at != '\0' && fields < 3);
+    if (*at != '\0' || at[-1] == ':') {
+        return 0;
+    }
+    sweep_quantum_first = (int)values[0];
+    sweep_quantum_last = fields > 1 ? (int)values[1] : (int)values[0];
+    sweep_quantum_step = (int)values[2];
+    return sweep_quantum_last >= sweep_quantum_first;
+}
+
+// Set this thread up for a run over the table it adopted: its own per-run
+// columns, a clock at zero and an empty Gantt chart
+static void prepare_run(int gantt_entries) {
+    size_t n = process_count + 1;
+    processes.remaining_time = arena_alloc(&arena, sizeof(int) * n);
+    processes.queue_index = arena_alloc(&arena, sizeof(int) * n);
+    processes.flags = arena_alloc(&arena, n);
+    processes.start_time = arena_alloc(&arena, sizeof(int) * n);
+    processes.finish_time = arena_alloc(&arena, sizeof(int) * n);
+    reset_processes();
+    arrival_cursor = 0;
+    current_time = 0;
+    gantt_capacity = gantt_entries;
+}
+
+static void* sweep_worker(void* arg) {
+    SweepJob* job = (SweepJob*)arg;
+    arena_init(&arena, ARENA_MIN_BLOCK);
+    gantt_recording = 0; // only the table is printed
+    while (1) {
+        int r = __atomic_fetch_add(&job->next_run, 1, __ATOMIC_RELAXED);
+        if (r >= job->run_count) {
+            break;
+        }
+        SweepRun* run = &job->runs[r];
+        arena_reset(&arena);
+        adopt_run_state(&job->input);
+        algorithm = run->algorithm;
+        if (run->quantum != -1) {
+            time_quantum = run->quantum;
+        }
+        prepare_run(job->gantt_capacity);
+        run_scheduler();
+        summarize_run(&run->summary);
+    }
+    arena_free_all(&arena);
+    return NULL;
+}
+
+void run_sweep(void) {
+    struct timespec sweep_start;
+    clock_gettime(CLOCK_MONOTONIC, &sweep_start);
+
+    SweepJob job;
+    save_run_state(&job.input);
+    job.gantt_capacity = 0; // nothing is recorded
+    int first = sweep_quantum_first > 0 ? sweep_quantum_first : time_quantum;
+    int last = sweep_quantum_first > 0 ? sweep_quantum_last : time_quantum;
+    int quanta = (int)(((long long)last - first) / sweep_quantum_step + 1);
+    job.runs = arena_alloc(&arena, sizeof(SweepRun) * sweep_count * (size_t)quanta);
+    job.run_count = 0;
+    job.next_run = 0;
+    for (int i = 0; i < sweep_count; i++) {
+        SchedulingAlgorithm a = sweep_algorithms[i];
+        int count = policy_table[a].uses_quantum ? quanta : 1;
+        for (int k = 0; k < count; k++) {
+            SweepRun* run = &job.runs[job.run_count++];
+            run->algorithm = a;
+            run->quantum = policy_table[a].uses_quantum ? first + k * sweep_quantum_step : -1;
+        }
+    }
+
+    int threads = sweep_threads;
+    if (threads <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores > 0 ? (int)cores : 1;
+    }
+    if (threads > job.run_count) {
+        threads = job.run_count;
+    }
+    pthread_t workers[threads];
+    int spawned = 0;
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&workers[spawned], NULL, sweep_worker, &job) == 0) {
+            spawned++;
+        }
+    }
+    if (spawned == 0) {
+        fprintf(stderr, "Error: could not start any sweep threads.\n");
+        exit(1);
+    }
+    for (int i = 0; i < spawned; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    if (show_stats) {
+        fprintf(stderr, "Swept %d run%s on %d thread%s in %.3f s\n", job.run_count,
+                job.run_count == 1 ? "" : "s", spawned, spawned == 1 ? "" : "s",
+                elapsed_seconds(&sweep_start));
+    }
+    print_sweep(job.runs, job.run_count);
+}
 
-        // Step 1: Check for arrivals at current_time
-        for (int i = 0; i < process_count; i++) {
-            if (processes[i].arrival == current_time && 
-                !processes[i].in_ready_queue && 
-                !processes[i].finished) {
-                enqueue_process(&processes[i]);
-            }
+// workload generator
+//
+// A spec is a comma separated list of key=value settings:
+//   processes=N                  processes per workload (default 1000)
+//   arrival=MEAN                 Poisson arrivals, mean time between them (default 5)
+//   arrival=poisson:MEAN         the same
+//   arrival=bursty:MEAN:CLUMP    clumps of CLUMP processes on average arriving
+//                                together, same long-run rate
+//   burst=MEAN                   exponential bursts (default 4)
+//   burst=exp:MEAN               the same
+//   burst=pareto:ALPHA:MIN       Pareto bursts, at least MIN
+//   burst=bimodal:SHORT:LONG:P   exponential around SHORT, or LONG with chance P
+//   priority=LO:HI               uniform priority range (default 1:10)
+//   priority=V@W/V@W/...         priority V with weight W
+// Bursts are rounded and at least 1. Settings left out keep their defaults.
+
+// Colon separated numbers in [start, end), how many there were, or -1
+static int parse_spec_numbers(const char* start, const char* end, double* values, int max) {
+    int count = 0;
+    while (count < max) {
+        char* next;
+        values[count] = strtod(start, &next);
+        if (next == start || next > end) {
+            return -1;
+        }
+        count++;
+        if (next == end) {
+            return count;
         }
+        if (*next != ':') {
+            return -1;
+        }
+        start = next + 1;
+    }
+    return -1;
+}
 
+// Strip a "model:" prefix off [*value, end), if it is there
+static int spec_model(const char** value, const char* end, const char* model) {
+    size_t len = strlen(model);
+    if ((size_t)(end - *value) > len && strncmp(*value, model, len) == 0 && (*value)[len] == ':') {
+        *value += len + 1;
+        return 1;
+    }
+    return 0;
+}
 
-        // STEP 2: Now check for preemption after arrivals
-        int should_preempt = 0;
+static int parse_priority_mix(const char* value, const char* end) {
+    int count = 0;
+    double total = 0;
+    while (value < end) {
+        if (count == MAX_PRIORITY_MIX) {
+            return 0;
+        }
+        char* next;
+        long priority = strtol(value, &next, 10);
+        if (next == value || *next != '@' || priority < INT_MIN || priority > INT_MAX) {
+            return 0;
+        }
+        value = next + 1;
+        double weight = strtod(value, &next);
+        if (next == value || next > end || !(weight > 0) || (next != end && *next != '/')) {
+            return 0;
+        }
+        total += weight;
+        workload_spec.mix_priority[count] = (int)priority;
+        workload_spec.mix_weight[count] = total;
+        count++;
+        value = next == end ? end : next + 1;
+    }
+    workload_spec.mix_count = count;
+    return count > 0;
+}
 
-            if (current_running != NULL && !current_running->finished) {
-            // RR: Check quantum expiration
-            if (algorithm == RR && quantum_remaining <= 0) {
-                should_preempt = 1;
+int parse_workload_spec(const char* spec) {
+    const char* at = spec;
+    while (*at != '\0') {
+        const char* end = strchr(at, ',');
+        if (end == NULL) {
+            end = at + strlen(at);
+        }
+        const char* eq = memchr(at, '=', end - at);
+        if (eq == NULL) {
+            return 0;
+        }
+        size_t key_len = eq - at;
+        const char* value = eq + 1;
+        double v[3];
+        if (key_len == 9 && strncmp(at, "processes", 9) == 0) {
+            char* value_end;
+            long n = strtol(value, &value_end, 10);
+            if (value_end != end || n < 1 || n > INT_MAX - 1) {
+                return 0;
             }
-            
-            // Priority: Check for higher priority in ready queue
-            if (algorithm == PRIORITY) {
-                for (int i = 0; i < ready_count; i++) {
-                    if (ready_queue[i]->priority < current_running->priority) {
-                        should_preempt = 1;
-                        break;
+            workload_spec.processes = (int)n;
+        } else if (key_len == 7 && strncmp(at, "arrival", 7) == 0) {
+            if (spec_model(&value, end, "bursty")) {
+                if (parse_spec_numbers(value, end, v, 2) != 2 || !(v[0] >= 0) || !(v[1] >= 1)) {
+                    return 0;
+                }
+                workload_spec.arrivals = ARRIVAL_BURSTY;
+                workload_spec.clump = v[1];
+            } else {
+                spec_model(&value, end, "poisson");
+                if (parse_spec_numbers(value, end, v, 1) != 1 || !(v[0] >= 0)) {
+                    return 0;
+                }
+                workload_spec.arrivals = ARRIVAL_POISSON;
+            }
+            workload_spec.arrival_gap = v[0];
+        } else if (key_len == 5 && strncmp(at, "burst", 5) == 0) {
+            if (spec_model(&value, end, "pareto")) {
+                if (parse_spec_numbers(value, end, v, 2) != 2 || !(v[0] > 0) || !(v[1] >= 1)) {
+                    return 0;
+                }
+                workload_spec.bursts = BURST_PARETO;
+                workload_spec.pareto_shape = v[0];
+                workload_spec.burst = v[1];
+            } else if (spec_model(&value, end, "bimodal")) {
+                if (parse_spec_numbers(value, end, v, 3) != 3 || !(v[0] >= 1) || !(v[1] >= 1) ||
+                    !(v[2] >= 0 && v[2] <= 1)) {
+                    return 0;
+                }
+                workload_spec.bursts = BURST_BIMODAL;
+                workload_spec.burst = v[0];
+                workload_spec.burst_long = v[1];
+                workload_spec.long_share = v[2];
+            } else {
+                spec_model(&value, end, "exp");
+                if (parse_spec_numbers(value, end, v, 1) != 1 || !(v[0] >= 1)) {
+                    return 0;
+                }
+                workload_spec.bursts = BURST_EXPONENTIAL;
+                workload_spec.burst = v[0];
+            }
+        } else if (key_len == 8 && strncmp(at, "priority", 8) == 0) {
+            if (memchr(value, '@', end - value) != NULL) {
+                if (!parse_priority_mix(value, end)) {
+                    return 0;
+                }
+            } else {
+                char* value_end;
+                long lo = strtol(value, &value_end, 10);
+                long hi = lo;
+                if (value_end == value) {
+                    return 0;
+                }
+                if (*value_end == ':') {
+                    const char* hi_start = value_end + 1;
+                    hi = strtol(hi_start, &value_end, 10);
+                    if (value_end == hi_start) {
+                        return 0;
                     }
                 }
+                if (value_end != end || lo > hi || lo < INT_MIN || hi > INT_MAX) {
+                    return 0;
+                }
+                workload_spec.priority_min = (int)lo;
+                workload_spec.priority_max = (int)hi;
+                workload_spec.mix_count = 0;
             }
+        } else {
+            return 0;
         }
+        at = *end == ',' ? end + 1 : end;
+    }
+    return 1;
+}
 
-        if (should_preempt) {
-            // Record partial execution in Gantt chart
-            if (execution_start != -1) {
-                strcpy(gantt_chart[gantt_count].pid, current_running->pid);
-                gantt_chart[gantt_count].start = execution_start;
-                gantt_chart[gantt_count].end = current_time;
-                gantt_count++;
-            }
-            
-            enqueue_process(current_running);
-            current_running = NULL;
-            execution_start = -1;
+static double uniform01(uint64_t* rng) {
+    return (splitmix64(rng) >> 11) * 0x1.0p-53;
+}
+
+static double exponential(uint64_t* rng, double mean) {
+    return -mean * log(1.0 - uniform01(rng));
+}
+
+// Processes in a clump, geometric with the given mean
+static int clump_size(uint64_t* rng, double mean) {
+    if (mean <= 1) {
+        return 1;
+    }
+    double size = 1 + floor(log(1.0 - uniform01(rng)) / log(1.0 - 1.0 / mean));
+    return size < INT_MAX ? (int)size : INT_MAX;
+}
+
+void generator_init(WorkloadGenerator* gen, const WorkloadSpec* spec, uint64_t rng) {
+    gen->spec = spec;
+    gen->rng = rng;
+    gen->clock = 0;
+    gen->clump_left = 0;
+    gen->generated = 0;
+}
+
+// Generator seed for workload k of --seed. A single generated run is
+// workload 0, so it replays Monte Carlo workload 0 and `schedsim generate`.
+static uint64_t workload_seed(int k) {
+    uint64_t state = seed ^ ((uint64_t)k * 0xd1b54a32d192ed03ull);
+    return splitmix64(&state);
+}
+
+// The next process in arrival order, 0 once the workload is complete
+int generator_next(WorkloadGenerator* gen, int* arrival, int* burst, int* priority) {
+    const WorkloadSpec* spec = gen->spec;
+    if (gen->generated == spec->processes) {
+        return 0;
+    }
+    if (spec->arrivals == ARRIVAL_POISSON) {
+        if (gen->generated > 0) {
+            gen->clock += exponential(&gen->rng, spec->arrival_gap);
+        }
+    } else if (gen->clump_left > 0) {
+        gen->clump_left--; // arrives with the rest of its clump
+    } else {
+        if (gen->generated > 0) {
+            gen->clock += exponential(&gen->rng, spec->arrival_gap * spec->clump);
         }
+        gen->clump_left = clump_size(&gen->rng, spec->clump) - 1;
+    }
+    // keep room for a burst of at least 1 after the arrival
+    *arrival = gen->clock < INT_MAX - 1 ? (int)gen->clock : INT_MAX - 1;
 
+    double units;
+    if (spec->bursts == BURST_EXPONENTIAL) {
+        units = exponential(&gen->rng, spec->burst);
+    } else if (spec->bursts == BURST_PARETO) {
+        units = spec->burst / pow(1.0 - uniform01(&gen->rng), 1.0 / spec->pareto_shape);
+    } else {
+        int long_burst = uniform01(&gen->rng) < spec->long_share;
+        units = exponential(&gen->rng, long_burst ? spec->burst_long : spec->burst);
+    }
+    units += 0.5;
+    int longest = INT_MAX - *arrival; // arrival + burst must not overflow
+    *burst = units < 1 ? 1 : units < longest ? (int)units : longest;
 
+    if (spec->mix_count == 0) {
+        uint64_t range = (uint64_t)((int64_t)spec->priority_max - spec->priority_min) + 1;
+        *priority = (int)(spec->priority_min + (int64_t)(splitmix64(&gen->rng) % range));
+    } else {
+        double pick = uniform01(&gen->rng) * spec->mix_weight[spec->mix_count - 1];
+        int m = 0;
+        while (m < spec->mix_count - 1 && pick >= spec->mix_weight[m]) {
+            m++;
+        }
+        *priority = spec->mix_priority[m];
+    }
+    gen->generated++;
+    return 1;
+}
 
-        // STEP 3: Select next process if needed
-        if (current_running == NULL || current_running->finished) {
-            if (current_running != NULL && current_running->finished) {
-                // Record finished process in Gantt
-                if (execution_start != -1) {
-                    strcpy(gantt_chart[gantt_count].pid, current_running->pid);
-                    gantt_chart[gantt_count].start = execution_start;
-                    gantt_chart[gantt_count].end = current_time;
-                    gantt_count++;
-                }
-                processes_finished++;
-            }
-            
-            current_running = select_next_process();
-            
-            if (current_running != NULL) {
+// Generate the input row `row` and set up its per-run columns
+void generate_row(int row) {
+    generator_next(&input_generator, &processes.arrival[row], &processes.burst[row], &processes.priority[row]);
+    processes.pid_id[row] = row;
+    processes.deadline[row] = NO_DEADLINE;
+    processes.remaining_time[row] = processes.burst[row];
+    processes.flags[row] = 0;
+    processes.start_time[row] = -1;
+    processes.finish_time[row] = 0;
+}
+
+// Set the table up for generated input. With input_lazy rows are generated
+// one arrival ahead as the scheduler admits them, so none exists ahead of
+// the clock, and the table starts at GENERATED_ROWS and doubles as they
+// come in (see grow_generated). Every row stays for the results table, so
+// a run still ends up holding the whole workload; only --stream bounds
+// memory. Otherwise all rows are generated now.
+void load_generated(void) {
+    int rows = workload_spec.processes;
+    if (input_lazy && rows > GENERATED_ROWS) {
+        rows = GENERATED_ROWS;
+    }
+    reserve_processes(rows);
+    process_count = rows;
+    arrival_order = NULL;
+    arrival_cursor = 0;
+    generator_init(&input_generator, &workload_spec, workload_seed(0));
+    for (int i = 0; i < (input_lazy ? 1 : process_count); i++) {
+        generate_row(i);
+    }
+}
+
+// The lazily generated table is full: double it, and the policy's
+// per-process state with it, as a streaming run grows its slots
+void grow_generated(void) {
+    int old_count = process_count;
+    int count = old_count < workload_spec.processes / 2 ? old_count * 2 : workload_spec.processes;
+    reserve_processes(count);
+    process_count = count;
+    policy_table[algorithm].policy->on_grow(old_count);
+}
+
+#define GENERATE_BLOCK 65536 // rows generated at a time when writing a binary workload
+
+static void write_generated_csv(FILE* file, WorkloadGenerator* gen) {
+    int arrival, burst, priority;
+    fprintf(file, "pid,arrival,burst,priority\n");
+    for (int i = 1; generator_next(gen, &arrival, &burst, &priority); i++) {
+        fprintf(file, "P%d,%d,%d,%d\n", i, arrival, burst, priority);
+    }
+}
+
+// Block by block, each block's slice of every column written in place, so
+// only GENERATE_BLOCK rows are ever held
+static void write_generated_binary(FILE* file, WorkloadGenerator* gen) {
+    uint64_t rows = gen->spec->processes;
+    uint64_t name_bytes = 0; // "P1" to "P<rows>"
+    for (uint64_t low = 1, digits = 1; low <= rows; low *= 10, digits++) {
+        uint64_t high = low * 10 - 1 < rows ? low * 10 - 1 : rows;
+        name_bytes += (high - low + 1) * (digits + 1);
+    }
+    WorkloadColumn columns[] = {
+        {"pid_id", COLUMN_U32, 4, rows, 0},
+        {"arrival", COLUMN_I32, 4, rows, 0},
+        {"burst", COLUMN_I32, 4, rows, 0},
+        {"priority", COLUMN_I32, 4, rows, 0},
+        {"pid_name_offsets", COLUMN_U64, 8, rows + 1, 0},
+        {"pid_name_bytes", COLUMN_U8, 1, name_bytes, 0},
+    };
+    write_workload_header(file, columns, sizeof(columns) / sizeof(columns[0]), rows);
+
+    uint32_t* pid_ids = arena_alloc(&arena, sizeof(uint32_t) * GENERATE_BLOCK);
+    int* arrivals = arena_alloc(&arena, sizeof(int) * GENERATE_BLOCK);
+    int* bursts = arena_alloc(&arena, sizeof(int) * GENERATE_BLOCK);
+    int* priorities = arena_alloc(&arena, sizeof(int) * GENERATE_BLOCK);
+    uint64_t* name_offsets = arena_alloc(&arena, sizeof(uint64_t) * (GENERATE_BLOCK + 1));
+    char* names = arena_alloc(&arena, (size_t)GENERATE_BLOCK * 12);
+    uint64_t name_at = 0;
+    for (uint64_t first = 0; first < rows; first += GENERATE_BLOCK) {
+        int count = 0;
+        size_t names_len = 0;
+        while (count < GENERATE_BLOCK &&
+               generator_next(gen, &arrivals[count], &bursts[count], &priorities[count])) {
+            pid_ids[count] = (uint32_t)(first + count);
+            name_offsets[count] = name_at + names_len;
+            names_len += sprintf(names + names_len, "P%llu", (unsigned long long)(first + count + 1));
+            count++;
+        }
+        write_column(file, columns[0].offset + 4 * first, pid_ids, 4 * count);
+        write_column(file, columns[1].offset + 4 * first, arrivals, 4 * count);
+        write_column(file, columns[2].offset + 4 * first, bursts, 4 * count);
+        write_column(file, columns[3].offset + 4 * first, priorities, 4 * count);
+        write_column(file, columns[4].offset + 8 * first, name_offsets, 8 * count);
+        write_column(file, columns[5].offset + name_at, names, names_len);
+        name_at += names_len;
+    }
+    write_column(file, columns[4].offset + 8 * rows, &name_at, 8);
+}
+
+// `schedsim generate` writes a --workload spec out as a trace
+int run_generate(int argc, char* argv[]) {
+    char* output = NULL;
+    int binary = 0;
+
+    static struct option long_opts[] = {
+        {"workload", required_argument, 0, 'w'},
+        {"seed", required_argument, 0, 'R'},
+        {"output", required_argument, 0, 'o'},
+        {"format", required_argument, 0, 'F'},
+        {"stats", no_argument, 0, 'S'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
 
-                if (current_running->start_time == -1) {
-                    current_running->started = 1;
-                    current_running->start_time = current_time;
-                    current_running->response_time = current_time - current_running->arrival;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "o:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+            case 'w':
+                if (!parse_workload_spec(optarg)) {
+                    fprintf(stderr, "Error: bad --workload '%s'.\n", optarg);
+                    return 1;
                 }
-                dequeue_process(current_running);
-                execution_start = current_time;
-                quantum_remaining = time_quantum;
+                break;
+            case 'R':
+                seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'F':
+                if (strcmp(optarg, "csv") == 0) {
+                    binary = 0;
+                } else if (strcmp(optarg, "binary") == 0) {
+                    binary = 1;
+                } else {
+                    fprintf(stderr, "Error: unknown format '%s'.\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'S':
+                show_stats = 1;
+                break;
+            case 'h':
+                print_usage("schedsim");
+                return 0;
+            default:
+                print_usage("schedsim");
+                return 1;
+        }
+    }
+    if (output == NULL) {
+        fprintf(stderr, "Error: generate needs an output file.\n\n");
+        print_usage("schedsim");
+        return 1;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    FILE* file = fopen(output, binary ? "wb" : "w");
+    if (file == NULL) {
+        perror("Error opening output file");
+        return 1;
+    }
+    arena_init(&arena, ARENA_MIN_BLOCK);
+    WorkloadGenerator gen;
+    generator_init(&gen, &workload_spec, workload_seed(0));
+    if (binary) {
+        write_generated_binary(file, &gen);
+    } else {
+        write_generated_csv(file, &gen);
+    }
+    if (fclose(file) != 0) {
+        perror("Error writing workload");
+        exit(1);
+    }
+    arena_free_all(&arena);
+    if (show_stats) {
+        fprintf(stderr, "Generated %d processes into %s in %.3f s\n", workload_spec.processes, output,
+                elapsed_seconds(&start));
+    }
+    return 0;
+}
+
+// Monte Carlo
+//
+// --monte-carlo K simulates K workloads drawn from the --workload spec.
+// Workload k is generated from its own seed, derived from --seed and k,
+// and its averages are kept by k, so the aggregate does not depend on
+// which thread ran what or on the number of threads. The workloads are
+// split evenly over the workers, and a worker that runs out steals the
+// back half of the largest share left.
+// Next workload for worker `self`, -1 when every share is empty
+static int monte_carlo_take(MonteCarloJob* job, int self) {
+    MonteCarloWorker* own = &job->workers[self];
+    pthread_mutex_lock(&own->lock);
+    int k = own->next < own->end ? own->next++ : -1;
+    pthread_mutex_unlock(&own->lock);
+    while (k == -1) {
+        int victim = -1;
+        int most = 0;
+        for (int w = 0; w < job->worker_count; w++) {
+            pthread_mutex_lock(&job->workers[w].lock);
+            int left = job->workers[w].end - job->workers[w].next;
+            pthread_mutex_unlock(&job->workers[w].lock);
+            if (left > most) {
+                victim = w;
+                most = left;
             }
         }
+        if (victim == -1) {
+            return -1; // shares only shrink, so nothing can turn up later
+        }
+        MonteCarloWorker* from = &job->workers[victim];
+        pthread_mutex_lock(&from->lock);
+        int left = from->end - from->next;
+        int take = (left + 1) / 2;
+        int first = from->end - take;
+        from->end = first;
+        pthread_mutex_unlock(&from->lock);
+        if (take == 0) {
+            continue; // emptied since the scan, look again
+        }
+        pthread_mutex_lock(&own->lock);
+        own->next = first + 1;
+        own->end = first + take;
+        own->steals++;
+        pthread_mutex_unlock(&own->lock);
+        k = first;
+    }
+    return k;
+}
 
-        // STEP 4: Execute ONE cycle
-        if (current_running != NULL && processes_finished < process_count) {
-            cpu_busy_cycles++;
-            
-            // Dispatch for ONE cycle
-            pthread_mutex_unlock(&scheduler_mutex);
-            sem_post(&current_running->semaphore);
-            sem_wait(&scheduler_sem);
-            
-            quantum_remaining--;
-            
-        } else {
-            // CPU idle this cycle
-            pthread_mutex_unlock(&scheduler_mutex);
+static void* monte_carlo_worker(void* arg) {
+    MonteCarloWorker* self = (MonteCarloWorker*)arg;
+    MonteCarloJob* job = self->job;
+    size_t n = process_count + 1;
+    arena_init(&arena, ARENA_MIN_BLOCK);
+    gantt_recording = 0; // only the summaries are printed
+    for (int k = monte_carlo_take(job, self->index); k != -1; k = monte_carlo_take(job, self->index)) {
+        arena_reset(&arena);
+        adopt_run_state(&job->input);
+        processes.arrival = arena_alloc(&arena, sizeof(int) * n);
+        processes.burst = arena_alloc(&arena, sizeof(int) * n);
+        processes.priority = arena_alloc(&arena, sizeof(int) * n);
+        processes.deadline = arena_alloc(&arena, sizeof(int) * n);
+        WorkloadGenerator gen;
+        generator_init(&gen, &workload_spec, workload_seed(k));
+        for (int i = 0; generator_next(&gen, &processes.arrival[i], &processes.burst[i],
+                                       &processes.priority[i]); i++) {
+            processes.deadline[i] = NO_DEADLINE;
         }
+        prepare_run(job->gantt_capacity);
+        run_scheduler();
+        summarize_run(&job->results[k]);
+        merge_run_metrics(self->pooled, run_metrics);
+    }
+    arena_free_all(&arena);
+    return NULL;
+}
+
+void run_monte_carlo(void) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
 
-        // STEP 5: Advance clock by 1 (only if we have not finished yet)
-        if (processes_finished < process_count) {
-            current_time++; // this fixes issue with less than 100% utilization issue
+    // Every workload has the same number of processes, generated in arrival
+    // order, so the PID ids are the same for all
+    process_count = workload_spec.processes;
+    processes.pid_id = arena_alloc(&arena, sizeof(uint32_t) * (process_count + 1));
+    arrival_order = NULL;
+    for (int i = 0; i < process_count; i++) {
+        processes.pid_id[i] = i;
+    }
+
+    MonteCarloJob job;
+    save_run_state(&job.input);
+    job.gantt_capacity = 0; // nothing is recorded
+    job.results = arena_alloc(&arena, sizeof(RunSummary) * monte_carlo_runs);
+    int threads = monte_carlo_threads;
+    if (threads <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores > 0 ? (int)cores : 1;
+    }
+    if (threads > monte_carlo_runs) {
+        threads = monte_carlo_runs;
+    }
+    job.workers = arena_alloc(&arena, sizeof(MonteCarloWorker) * threads);
+    job.worker_count = threads;
+    for (int w = 0; w < threads; w++) {
+        MonteCarloWorker* worker = &job.workers[w];
+        worker->job = &job;
+        worker->index = w;
+        pthread_mutex_init(&worker->lock, NULL);
+        worker->next = (int)((long long)monte_carlo_runs * w / threads);
+        worker->end = (int)((long long)monte_carlo_runs * (w + 1) / threads);
+        worker->steals = 0;
+        worker->pooled = new_run_metrics();
+    }
+    int spawned = 0;
+    for (int w = 0; w < threads; w++) {
+        if (pthread_create(&job.workers[w].thread, NULL, monte_carlo_worker, &job.workers[w]) != 0) {
+            break; // the ones that did start steal this one's share
         }
+        spawned++;
     }
-    
-    // Calculate actual CPU utilization
-    cpu_utilization = (float)cpu_busy_cycles / current_time * 100.0;
-    // Store for later printing
+    if (spawned == 0) {
+        fprintf(stderr, "Error: could not start any Monte Carlo threads.\n");
+        exit(1);
+    }
+    int steals = 0;
+    for (int w = 0; w < spawned; w++) {
+        pthread_join(job.workers[w].thread, NULL);
+        steals += job.workers[w].steals;
+    }
+    // merged in any order, the counts are exact
+    RunMetrics* pooled = new_run_metrics();
+    for (int w = 0; w < threads; w++) {
+        pthread_mutex_destroy(&job.workers[w].lock);
+        merge_run_metrics(pooled, job.workers[w].pooled);
+    }
+
+    if (show_stats) {
+        fprintf(stderr, "Simulated %d workload%s on %d thread%s in %.3f s, %d steal%s\n",
+                monte_carlo_runs, monte_carlo_runs == 1 ? "" : "s", spawned, spawned == 1 ? "" : "s",
+                elapsed_seconds(&start), steals, steals == 1 ? "" : "s");
+    }
+    print_monte_carlo(job.results, monte_carlo_runs, pooled);
 }
 
-// printing results
-void print_results() {
-    char algoString[16];
-    switch (algorithm) {
-        case FCFS:
-            strcpy(algoString, "FCFS");
-            break;
-        case SJF:
-            strcpy(algoString, "SJF");
-            break;
-        case RR:
-            strcpy(algoString, "RR");
-            break;
-        case PRIORITY:
-            strcpy(algoString, "Priority");
-            break;
+// streaming
+//
+// With --stream the process table is a pool of slots instead of one row
+// per input row. The row after the last admitted one is read ahead into a
+// free slot, so the scheduler loop sees its arrival time as usual, and a
+// process that finishes is printed, added to the totals and its slot put
+// back. The pool doubles when every slot is live, and each policy grows
+// its per-process columns with it (on_grow). The mapped input is dropped
+// from memory behind the reader, so what stays resident is the live
+// processes and one Gantt band, however long the trace.
+
+// Double the slots. Only called from the loop, after the policy is set up.
+static void stream_grow(void) {
+    int old_count = process_count;
+    int count = old_count * 2;
+    reserve_processes(count);
+    stream.names = arena_grow(&arena, stream.names, sizeof(PidSlice) * old_count, sizeof(PidSlice) * count);
+    stream.row_of = arena_grow(&arena, stream.row_of, sizeof(uint64_t) * old_count, sizeof(uint64_t) * count);
+    stream.free_slots = arena_grow(&arena, stream.free_slots, sizeof(int) * old_count, sizeof(int) * count);
+    if (stream.input == STREAM_GENERATED) {
+        stream.generated_names = arena_grow(&arena, stream.generated_names, (size_t)STREAM_NAME * old_count,
+                                            (size_t)STREAM_NAME * count);
     }
+    process_count = count;
+    for (int slot = count - 1; slot >= old_count; slot--) {
+        stream.free_slots[stream.free_count++] = slot;
+    }
+    policy_table[algorithm].policy->on_grow(old_count);
+}
 
-    for (int i = 0; i < process_count; i++) {
-        processes[i].waiting_time = processes[i].turnaround_time - processes[i].burst;
+// The next CSV row into `slot`, 0 at the end of the file
+static int stream_csv_row(int slot) {
+    const char* end = input_map + input_size;
+    while (stream.at < end) {
+        const char* eol = memchr(stream.at, '\n', end - stream.at);
+        if (eol == NULL) {
+            eol = end;
+        }
+        const char* line = stream.at;
+        stream.at = eol < end ? eol + 1 : end;
+        stream.line++;
+
+        const char* first = line;
+        const char* last = eol;
+        trim_field(&first, &last);
+        if (first == last) { // blank line
+            continue;
+        }
+        // the rows before this one have been printed, so stop at the first bad one
+        const char* error = parse_row(line, eol, slot, &stream.names[slot]);
+        if (error != NULL) {
+            fprintf(stderr, "%s:%d: malformed row: %s\n", stream.filename, stream.line, error);
+            exit(1);
+        }
+        if ((uint64_t)(line - input_map) - stream.released >= STREAM_RELEASE) {
+            release_pages(input_map + stream.released, line);
+            stream.released = line - input_map;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+// The next binary row into `slot`, 0 after the last one
+static int stream_binary_row(int slot) {
+    if (stream.rows == stream.row_count) {
+        return 0;
+    }
+    uint64_t row = stream.rows;
+    uint32_t id = stream.pid_ids[row];
+    if (id >= stream.name_count || stream.name_offsets[id] > stream.name_offsets[id + 1] ||
+        stream.name_offsets[id + 1] > stream.name_bytes_count) {
+        fprintf(stderr, "Error: %s: row %llu has a bad pid id\n", stream.filename, (unsigned long long)row);
+        exit(1);
+    }
+    if (stream.arrivals[row] < 0 || stream.bursts[row] < 1) {
+        fprintf(stderr, "Error: %s: row %llu has a negative arrival or a burst below 1\n",
+                stream.filename, (unsigned long long)row);
+        exit(1);
+    }
+    if (stream.bursts[row] > INT_MAX - stream.arrivals[row]) {
+        fprintf(stderr, "Error: %s: row %llu has an arrival plus burst that is too large\n",
+                stream.filename, (unsigned long long)row);
+        exit(1);
+    }
+    processes.arrival[slot] = stream.arrivals[row];
+    processes.burst[slot] = stream.bursts[row];
+    processes.priority[slot] = stream.priorities[row];
+    processes.deadline[slot] = stream.deadlines != NULL ? stream.deadlines[row] : NO_DEADLINE;
+    stream.names[slot].start = stream.name_bytes + stream.name_offsets[id];
+    stream.names[slot].len = (uint32_t)(stream.name_offsets[id + 1] - stream.name_offsets[id]);
+    stream.names[slot].hash = 0;
+    if ((row - stream.released) * stream.row_bytes >= STREAM_RELEASE) {
+        release_pages(stream.pid_ids + stream.released, stream.pid_ids + row);
+        release_pages(stream.arrivals + stream.released, stream.arrivals + row);
+        release_pages(stream.bursts + stream.released, stream.bursts + row);
+        release_pages(stream.priorities + stream.released, stream.priorities + row);
+        if (stream.deadlines != NULL) {
+            release_pages(stream.deadlines + stream.released, stream.deadlines + row);
+        }
+        stream.released = row;
+        // names are usually in row order too, a live one behind this just faults back in
+        if (id > stream.released_name) {
+            release_pages(stream.name_offsets + stream.released_name, stream.name_offsets + id);
+            release_pages(stream.name_bytes + stream.name_offsets[stream.released_name],
+                          stream.name_bytes + stream.name_offsets[id]);
+            stream.released_name = id;
+        }
+    }
+    return 1;
+}
+
+// The next generated row into `slot`, 0 once the spec's processes are out
+static int stream_generated_row(int slot) {
+    if (!generator_next(&input_generator, &processes.arrival[slot], &processes.burst[slot],
+                        &processes.priority[slot])) {
+        return 0;
+    }
+    processes.deadline[slot] = NO_DEADLINE;
+    char* name = stream.generated_names + (size_t)STREAM_NAME * slot;
+    stream.names[slot].start = name;
+    stream.names[slot].len = snprintf(name, STREAM_NAME, "P%llu", (unsigned long long)stream.rows + 1);
+    stream.names[slot].hash = 0;
+    return 1;
+}
+
+// Read the next row of the input ahead into a free slot (stream.next), or
+// set stream.next to -1 when there are no more
+void stream_read(void) {
+    if (stream.free_count == 0) {
+        stream_grow();
+    }
+    int slot = stream.free_slots[--stream.free_count];
+    int read = stream.input == STREAM_CSV ? stream_csv_row(slot)
+             : stream.input == STREAM_BINARY ? stream_binary_row(slot)
+             : stream_generated_row(slot);
+    if (!read) {
+        stream.free_slots[stream.free_count++] = slot;
+        stream.next = -1;
+        return;
+    }
+    // a row arriving before the one above it would have been admitted late
+    if (processes.arrival[slot] < stream.last_arrival) {
+        if (stream.input == STREAM_CSV) {
+            fprintf(stderr, "%s:%d: rows must be in arrival order to stream\n", stream.filename, stream.line);
+        } else {
+            fprintf(stderr, "Error: %s: row %llu is out of arrival order, it cannot be streamed\n",
+                    stream.filename, (unsigned long long)stream.rows);
+        }
+        exit(1);
+    }
+    stream.last_arrival = processes.arrival[slot];
+    processes.pid_id[slot] = slot;
+    processes.remaining_time[slot] = processes.burst[slot];
+    processes.flags[slot] = 0;
+    processes.start_time[slot] = -1;
+    processes.finish_time[slot] = 0;
+    stream.row_of[slot] = stream.rows++;
+    stream.next = slot;
+}
+
+// Set up a streaming run over `filename`, or over --workload without one,
+// and read the first row
+void load_stream(const char* filename) {
+    memset(&stream, 0, sizeof(stream));
+    stream.filename = filename;
+    arrival_order = NULL;
+    arrival_cursor = 0;
+    process_count = 0;
+    reserve_processes(STREAM_SLOTS);
+    process_count = STREAM_SLOTS;
+    stream.names = arena_alloc(&arena, sizeof(PidSlice) * STREAM_SLOTS);
+    stream.row_of = arena_alloc(&arena, sizeof(uint64_t) * STREAM_SLOTS);
+    stream.free_slots = arena_alloc(&arena, sizeof(int) * STREAM_SLOTS);
+    for (int slot = STREAM_SLOTS - 1; slot >= 0; slot--) {
+        stream.free_slots[stream.free_count++] = slot;
+    }
+    gantt_capacity = GANTT_BAND;
+
+    if (input_generated) {
+        stream.input = STREAM_GENERATED;
+        stream.generated_names = arena_alloc(&arena, (size_t)STREAM_NAME * STREAM_SLOTS);
+        generator_init(&input_generator, &workload_spec, workload_seed(0));
+    } else {
+        map_input(filename);
+        if (is_binary_workload()) {
+            const WorkloadHeader* header = (const WorkloadHeader*)input_map;
+            if (header->version != WORKLOAD_VERSION || header->byte_order != WORKLOAD_BYTE_ORDER ||
+                header->column_count > (input_size - sizeof(WorkloadHeader)) / sizeof(WorkloadColumn)) {
+                fprintf(stderr, "Error: %s: unsupported or corrupt workload header\n", filename);
+                exit(1);
+            }
+            uint64_t rows = header->row_count;
+            const WorkloadColumn* offsets = require_column(filename, "pid_name_offsets", COLUMN_U64, UINT64_MAX);
+            const WorkloadColumn* bytes = require_column(filename, "pid_name_bytes", COLUMN_U8, UINT64_MAX);
+            const WorkloadColumn* deadlines = find_column(filename, "deadline", COLUMN_I32, rows);
+            stream.input = STREAM_BINARY;
+            stream.row_count = rows;
+            stream.pid_ids = (const uint32_t*)(input_map + require_column(filename, "pid_id", COLUMN_U32, rows)->offset);
+            stream.arrivals = (const int32_t*)(input_map + require_column(filename, "arrival", COLUMN_I32, rows)->offset);
+            stream.bursts = (const int32_t*)(input_map + require_column(filename, "burst", COLUMN_I32, rows)->offset);
+            stream.priorities = (const int32_t*)(input_map +
+                require_column(filename, "priority", COLUMN_I32, rows)->offset);
+            stream.deadlines = deadlines != NULL ? (const int32_t*)(input_map + deadlines->offset) : NULL;
+            stream.name_offsets = (const uint64_t*)(input_map + offsets->offset);
+            stream.name_bytes = input_map + bytes->offset;
+            stream.name_count = offsets->count > 0 ? offsets->count - 1 : 0;
+            stream.name_bytes_count = bytes->count;
+            stream.row_bytes = sizeof(uint32_t) + 3 * sizeof(int32_t) + (deadlines != NULL ? sizeof(int32_t) : 0) +
+                               sizeof(uint64_t) + (rows > 0 ? bytes->count / rows : 0);
+            has_deadlines = deadlines != NULL;
+        } else {
+            // the header only tells us whether there is a deadline column
+            const char* end = input_map + input_size;
+            const char* body = input_size > 0 ? memchr(input_map, '\n', input_size) : NULL;
+            deadline_column = find_header_column(input_map, body != NULL ? body : end, "deadline");
+            if (deadline_column >= 0 && deadline_column < 4) {
+                fprintf(stderr, "Error: %s: the deadline column must come after pid,arrival,burst,priority\n",
+                        filename);
+                exit(1);
+            }
+            has_deadlines = deadline_column >= 0;
+            stream.input = STREAM_CSV;
+            stream.at = body != NULL ? body + 1 : end;
+            stream.line = 1;
+        }
+    }
+    stream_read();
+}
+
+// A process finished and is recorded: print its row and hold its slot
+// until the Gantt band with its last segment is out. That segment was just
+// added, so there are never more held slots than band entries.
+void retire_process(int process) {
+    print_result_row(process);
+    stream.live--;
+    stream.pending[stream.pending_count++] = process;
+}
+
+// Write the Gantt entries so far as one band of the chart (dropped without
+// --gantt), then free the slots that were waiting for it
+void flush_gantt_band(void) {
+    if (gantt_file != NULL && gantt_chart.count > 0) {
+        print_gantt_chart(gantt_file, stream.bands == 0 ? "Timeline (Gantt Chart)" : NULL,
+                          gantt_chart.entries, gantt_chart.count);
+        stream.bands++;
     }
+    gantt_chart.count = 0; // its end stays, for the idle gap before the next band
+    for (int i = 0; i < stream.pending_count; i++) {
+        stream.free_slots[stream.free_count++] = stream.pending[i];
+    }
+    stream.pending_count = 0;
+}
+
+// printing results
+void print_results_header(void) {
+    const char* algoString = policy_table[algorithm].policy->name;
 
     printf("\n====================== %s Scheduling ======================\n", algoString);
     printf("------------------------------------------------------------\n");
-    printf("PID\tArr\tBurst\tStart\tFinish\tWait\tResp\tTurn\n");
+    printf("PID\tArr\tBurst\tStart\tFinish\tWait\tResp\tTurn%s\n",
+           has_deadlines ? "\tDdl\tLate" : "");
     printf("------------------------------------------------------------\n");
+}
 
-    for (int i = 0; i < process_count; i++) {
-        printf("%s\t%d\t%d\t%d\t%d\t%d\t%d\t%d\n",
-               processes[i].pid,
-               processes[i].arrival,
-               processes[i].burst,
-               processes[i].start_time,
-               processes[i].finish_time,
-               processes[i].waiting_time,
-               processes[i].response_time,
-               processes[i].turnaround_time);
+// Wait, response and turnaround are derived from the start and finish
+// columns, and so is lateness (finish minus deadline, negative when early)
+void print_result_row(int i) {
+    int turnaround_time = processes.finish_time[i] - processes.arrival[i];
+    int response_time = processes.start_time[i] - processes.arrival[i];
+    int waiting_time = turnaround_time - processes.burst[i];
+    int pid_len;
+    const char* pid = pid_name(processes.pid_id[i], &pid_len);
+    printf("%.*s\t%d\t%d\t%d\t%d\t%d\t%d\t%d",
+           pid_len, pid,
+           processes.arrival[i],
+           processes.burst[i],
+           processes.start_time[i],
+           processes.finish_time[i],
+           waiting_time,
+           response_time,
+           turnaround_time);
+    if (has_deadlines && processes.deadline[i] == NO_DEADLINE) {
+        printf("\t-\t-");
+    } else if (has_deadlines) {
+        int lateness = processes.finish_time[i] - processes.deadline[i];
+        printf("\t%d\t%d", processes.deadline[i], lateness);
+    }
+    printf("\n");
+}
+
+// A streaming run has already printed the header and its rows
+void print_results() {
+    if (!stream_mode) {
+        print_results_header();
+        for (int i = 0; i < process_count; i++) {
+            print_result_row(i);
+        }
     }
     printf("------------------------------------------------------------\n");
     
     // Calculate and print averages
-    float avg_wait = 0, avg_resp = 0, avg_turn = 0;
-    for (int i = 0; i < process_count; i++) {
-        avg_wait += processes[i].waiting_time;
-        avg_resp += processes[i].response_time;
-        avg_turn += processes[i].turnaround_time;
-    }
-    avg_wait /= process_count;
-    avg_resp /= process_count;
-    avg_turn /= process_count;
+    RunSummary summary;
+    summarize_run(&summary);
     
-    printf("\nAvg Wait = %.2f\n", avg_wait);
-    printf("Avg Resp = %.2f\n", avg_resp);
-    printf("Avg Turn = %.2f\n", avg_turn);
-    printf("Throughput = %.2f jobs/unit time\n", (float)process_count / current_time);
-    printf("CPU Utilization = %.2f%%\n\n", cpu_utilization);  // Oops, left this hard coded as 100% earlier for testing
-    print_gantt_chart();
+    printf("\nAvg Wait = %.2f\n", summary.avg_wait);
+    printf("Avg Resp = %.2f\n", summary.avg_resp);
+    printf("Avg Turn = %.2f\n", summary.avg_turn);
+    printf("Throughput = %.2f jobs/unit time\n", summary.throughput);
+    if (has_deadlines) {
+        printf("Deadline Misses = %d of %d (%.2f%%)\n", summary.deadline_misses, summary.deadline_count,
+               summary.deadline_count > 0 ? 100.0 * summary.deadline_misses / summary.deadline_count : 0.0);
+    }
+    printf("CPU Utilization = %.2f%%\n\n", summary.utilization);  // Oops, left this hard coded as 100% earlier for testing
+    print_percentiles(run_metrics);
+    if (stream_mode) {
+        flush_gantt_band(); // the last band
+        if (show_stats) {
+            fprintf(stderr, "Streamed %llu processes, at most %d live in %d slots\n",
+                    (unsigned long long)stream.rows, stream.peak_live, process_count);
+        }
+        return;
+    }
+    FILE* out = gantt_file != NULL ? gantt_file : stdout;
+    if (cpu_count == 1) {
+        if (show_stats) {
+            fprintf(stderr, "Gantt chart: %d segments in %zu bytes\n", gantt_chart.count,
+                    gantt_lane_bytes(&gantt_chart));
+        }
+        print_gantt_lane(out, "Timeline (Gantt Chart)", &gantt_chart);
+        return;
+    }
+
+    // Per-core utilization and migrations, then one Gantt lane per CPU
+    int migrations = 0;
+    printf("CPU\tBusy\tUtil\tMigr\n");
+    for (int c = 0; c < cpu_count; c++) {
+        printf("%d\t%lld\t%.2f%%\t%d\n", c, cpus[c].busy,
+               current_time > 0 ? 100.0 * cpus[c].busy / current_time : 0.0, cpus[c].migrations);
+        migrations += cpus[c].migrations;
+    }
+    printf("Migrations = %d\n", migrations);
+    for (int c = 0; c < cpu_count; c++) {
+        char title[32];
+        snprintf(title, sizeof(title), "CPU %d Timeline", c);
+        print_gantt_lane(out, title, &cpus[c].gantt);
+    }
+}
+
+// Averages and tail of the run this thread just finished, from the
+// histograms its completions went into
+void summarize_run(RunSummary* summary) {
+    const Histogram* metric = run_metrics->metric;
+    uint64_t finished = metric[METRIC_TURN].count; // 0 for an empty trace, which reports zeros
+    summary->avg_wait = finished > 0 ? (float)metric[METRIC_WAIT].sum / finished : 0.0f;
+    summary->avg_resp = finished > 0 ? (float)metric[METRIC_RESP].sum / finished : 0.0f;
+    summary->avg_turn = finished > 0 ? (float)metric[METRIC_TURN].sum / finished : 0.0f;
+    summary->throughput = current_time > 0 ? (float)finished / current_time : 0.0f;
+    summary->utilization = cpu_utilization;
+    summary->deadline_count = run_metrics->deadline_count;
+    summary->deadline_misses = run_metrics->deadline_misses;
+    for (int m = 0; m < METRIC_COUNT; m++) {
+        summary->p99[m] = hist_percentile(&metric[m], 0.99);
+    }
+}
+
+// Tail of each metric, from its histogram (within one bucket, under 1.6%)
+void print_percentiles(const RunMetrics* metrics) {
+    static const char* names[METRIC_COUNT] = { "Wait", "Resp", "Turn" };
+    printf("Metric\tp50\tp90\tp99\tp99.9\tMax\n");
+    for (int m = 0; m < METRIC_COUNT; m++) {
+        const Histogram* hist = &metrics->metric[m];
+        printf("%s\t%d\t%d\t%d\t%d\t%d\n", names[m], hist_percentile(hist, 0.5), hist_percentile(hist, 0.9),
+               hist_percentile(hist, 0.99), hist_percentile(hist, 0.999), hist->max);
+    }
+    printf("\n");
+}
+
+// One row per sweep run, in the order the runs were listed
+void print_sweep(const SweepRun* runs, int count) {
+    printf("\n====================== Parameter Sweep ======================\n");
+    printf("------------------------------------------------------------\n");
+    printf("Policy\tQuantum\tWait\tResp\tTurn\tWp99\tRp99\tTp99\tThruput\tUtil%s\n",
+           has_deadlines ? "\tMissed" : "");
+    printf("------------------------------------------------------------\n");
+    for (int r = 0; r < count; r++) {
+        const RunSummary* summary = &runs[r].summary;
+        printf("%s\t", policy_table[runs[r].algorithm].policy->name);
+        if (runs[r].quantum == -1) {
+            printf("-\t");
+        } else {
+            printf("%d\t", runs[r].quantum);
+        }
+        printf("%.2f\t%.2f\t%.2f\t%d\t%d\t%d\t%.2f\t%.2f%%", summary->avg_wait, summary->avg_resp,
+               summary->avg_turn, summary->p99[METRIC_WAIT], summary->p99[METRIC_RESP],
+               summary->p99[METRIC_TURN], summary->throughput, summary->utilization);
+        if (has_deadlines) {
+            printf("\t%.2f%%", summary->deadline_count > 0
+                   ? 100.0 * summary->deadline_misses / summary->deadline_count : 0.0);
+        }
+        printf("\n");
+    }
+    printf("------------------------------------------------------------\n\n");
 }
 
-void print_gantt_chart() {
-    if (gantt_count == 0) return;
+// Mean, standard deviation and 95% confidence interval of the mean (normal
+// approximation) of each average over the Monte Carlo workloads, then the
+// percentiles of every process of every workload pooled together
+void print_monte_carlo(const RunSummary* results, int count, const RunMetrics* pooled) {
+    static const struct {
+        const char* name;
+        size_t offset;
+        int decimals;
+    } metrics[] = {
+        { "Avg Wait", offsetof(RunSummary, avg_wait), 2 },
+        { "Avg Resp", offsetof(RunSummary, avg_resp), 2 },
+        { "Avg Turn", offsetof(RunSummary, avg_turn), 2 },
+        { "Throughput", offsetof(RunSummary, throughput), 4 },
+        { "CPU Util", offsetof(RunSummary, utilization), 2 },
+    };
+
+    printf("\n====================== %s Monte Carlo ======================\n",
+           policy_table[algorithm].policy->name);
+    printf("%d workloads of %d processes, seed %llu\n", count, process_count, (unsigned long long)seed);
+    printf("------------------------------------------------------------\n");
+    printf("%-12s%-10s%-10s%s\n", "Metric", "Mean", "StdDev", "95% CI");
+    printf("------------------------------------------------------------\n");
+    for (size_t m = 0; m < sizeof(metrics) / sizeof(metrics[0]); m++) {
+        // summed in workload order, so the result is the same on any thread count
+        double sum = 0;
+        for (int k = 0; k < count; k++) {
+            sum += *(const float*)((const char*)&results[k] + metrics[m].offset);
+        }
+        double mean = sum / count;
+        double squares = 0;
+        for (int k = 0; k < count; k++) {
+            double delta = *(const float*)((const char*)&results[k] + metrics[m].offset) - mean;
+            squares += delta * delta;
+        }
+        double sd = count > 1 ? sqrt(squares / (count - 1)) : 0.0;
+        double half = 1.96 * sd / sqrt(count);
+        int d = metrics[m].decimals;
+        printf("%-12s%-10.*f%-10.*f%.*f .. %.*f\n", metrics[m].name, d, mean, d, sd,
+               d, mean - half, d, mean + half);
+    }
+    printf("------------------------------------------------------------\n\n");
+    print_percentiles(pooled);
+}
+
+// A plain lane in one piece, a compact one decoded a band at a time
+void print_gantt_lane(FILE* out, const char* title, const GanttLane* lane) {
+    if (lane->bytes == NULL) {
+        print_gantt_chart(out, title, lane->entries, lane->count);
+        return;
+    }
+    GanttEntry band[GANTT_BAND];
+    GanttCursor cursor;
+    gantt_cursor_init(&cursor, lane);
+    int count = 0;
+    while (gantt_cursor_next(&cursor, &band[count])) {
+        if (++count == GANTT_BAND) {
+            print_gantt_chart(out, title, band, count);
+            title = NULL; // the rest continue it
+            count = 0;
+        }
+    }
+    print_gantt_chart(out, title, band, count);
+}
+
+void print_gantt_chart(FILE* out, const char* title, const GanttEntry* entries, int count) {
+    if (count == 0) return;
     
-    printf("\nTimeline (Gantt Chart):\n");
+    if (title != NULL) { // NULL continues the chart above
+        fprintf(out, "\n%s:\n", title);
+    }
     
     // Print time markers
-    for (int i = 0; i < gantt_count; i++) {
-        printf("%-9d", gantt_chart[i].start);
+    for (int i = 0; i < count; i++) {
+        fprintf(out, "%-9d", entries[i].start);
     }
-    printf("%d\n", gantt_chart[gantt_count - 1].end);
+    fprintf(out, "%d\n", entries[count - 1].end);
     
     // Print top separator
-    for (int i = 0; i < gantt_count; i++) {
-        printf("|--------");
+    for (int i = 0; i < count; i++) {
+        fprintf(out, "|--------");
     }
-    printf("|\n");
+    fprintf(out, "|\n");
     
     // Print process names, note ChatGPT did help me with this, mentioned in README
-    for (int i = 0; i < gantt_count; i++) {
-        int pid_len = strlen(gantt_chart[i].pid);
+    for (int i = 0; i < count; i++) {
+        int pid_len = 4;
+        const char* pid = "idle";
+        if (entries[i].pid_id != GANTT_IDLE) {
+            pid = pid_name(entries[i].pid_id, &pid_len);
+        }
         int padding_left = (8 - pid_len) / 2;
         int padding_right = 8 - pid_len - padding_left;
         
-        printf("|");
-        for (int j = 0; j < padding_left; j++) printf(" ");
-        printf("%s", gantt_chart[i].pid);
-        for (int j = 0; j < padding_right; j++) printf(" ");
+        fprintf(out, "|");
+        for (int j = 0; j < padding_left; j++) fprintf(out, " ");
+        fprintf(out, "%.*s", pid_len, pid);
+        for (int j = 0; j < padding_right; j++) fprintf(out, " ");
     }
-    printf("|\n");
+    fprintf(out, "|\n");
     
     // Print bottom separator
-    for (int i = 0; i <= gantt_count; i++) {
-        printf("--------");
+    for (int i = 0; i <= count; i++) {
+        fprintf(out, "--------");
     }
-    printf("-\n");
+    fprintf(out, "-\n");
 }
 
 static void print_usage(const char *progname) {
     fprintf(stderr,
         "Usage: %s [options]\n"
+        "       %s convert -i <trace.csv> -o <trace.bin>\n"
+        "       %s bench-queue [--ops N]\n"
+        "       %s generate --workload <spec> [--seed N] -o <trace> [--format csv|binary]\n"
         "Options:\n"
         "-f,  --fcfs                Use FCFS scheduling\n"
         "-s,  --sjf                 Use SJF (Shortest Job First) scheduling\n"
         "-r,  --rr                  Use Round Robin scheduling\n"
         "-p,  --priority            Use Priority scheduling\n"
-        "-i,  --input <file>        Input CSV filename (required)\n"
+        "-t,  --srtf                Use SRTF (preemptive SJF) scheduling\n"
+        "     --cfs                 Use CFS (fair share by vruntime, priority is\n"
+        "                           the nice value, -20..19)\n"
+        "     --cfs-latency <N>     CFS target latency (default 24)\n"
+        "     --cfs-min-granularity <N> CFS minimum slice (default 3)\n"
+        "     --mlfq                Use a multilevel feedback queue\n"
+        "     --mlfq-levels <N>     MLFQ levels (default 3, at most 64)\n"
+        "     --mlfq-quanta <a,b,..> Quantum per level from the top (default: -q,\n"
+        "                           doubling at each level below)\n"
+        "     --mlfq-boost <N>      Move everything to the top level every N\n"
+        "                           time units (default 100, 0 = never)\n"
+        "     --edf                 Use preemptive EDF (earliest deadline first,\n"
+        "                           needs a deadline column)\n"
+        "     --lottery             Use lottery scheduling (priority is the ticket\n"
+        "                           count, one draw per quantum)\n"
+        "     --stride              Use stride scheduling (priority is the ticket\n"
+        "                           count, one pick per quantum)\n"
+        "     --seed <N>            Seed for the lottery draws and generated\n"
+        "                           workloads (default 1)\n"
+        "     --cpus <N>            Simulated CPUs (default 1, direct engine only)\n"
+        "     --balance <mode>      global (default, one shared ready queue) or\n"
+        "                           steal (per-CPU run queues, idle CPUs steal)\n"
+        "     --balance-interval <N> Time between work-stealing passes (default 4)\n"
+        "     --host-threads <N>    Host threads running the CPUs with --balance\n"
+        "                           steal (default 1, 0 = one per core)\n"
+        "     --sweep <a,b,..>      Run each listed policy (option names, e.g.\n"
+        "                           fcfs,rr,mlfq, or all) and print one summary\n"
+        "                           table instead of the per-process results\n"
+        "     --sweep-quanta <first:last[:step]> Quanta to sweep for the policies\n"
+        "                           that use one (default: -q)\n"
+        "     --sweep-threads <N>   Threads running the sweep (default: one per\n"
+        "                           core)\n"
+        "     --monte-carlo <K>     Simulate K workloads generated from --workload\n"
+        "                           and print the mean, standard deviation and 95%%\n"
+        "                           confidence interval of each average (no -i)\n"
+        "     --monte-carlo-threads <N> Threads running them (default: one per core)\n"
+        "     --workload <spec>     Generate the input instead of -i (also what\n"
+        "                           --monte-carlo draws from), key=value,... with\n"
+        "                           processes=N (default 1000)\n"
+        "                           arrival=[poisson:]MEAN gap (5) or\n"
+        "                             bursty:MEAN:CLUMP (clumps arriving together)\n"
+        "                           burst=[exp:]MEAN (4), pareto:ALPHA:MIN or\n"
+        "                             bimodal:SHORT:LONG:P (long with chance P)\n"
+        "                           priority=LO:HI (1:10) or V@W/V@W/.. (weighted)\n"
+        "     --stream              Read the input as the clock reaches it and\n"
+        "                           print each process when it finishes, holding\n"
+        "                           only the live ones (one CPU, input in arrival\n"
+        "                           order)\n"
+        "     --gantt <file>        Write the Gantt chart to a file (with --stream\n"
+        "                           it is written as the run goes, and left out\n"
+        "                           without this)\n"
+        "     --gantt-compact       Keep the Gantt chart delta-encoded, a few\n"
+        "                           bytes a segment, and print it in bands\n"
+        "-i,  --input <file>        Input CSV or binary workload (required)\n"
         "-q,  --quantum <N>         Time quantum for Round Robin (default 1)\n"
-        "-h,  --help                Show this help message\n",
-        progname);
+        "-e,  --engine <name>       direct (default, no threads) or threaded\n"
+        "                           (one pthread per process)\n"
+        "     --parse-threads <N>   Threads used to parse the input (default: one\n"
+        "                           per core)\n"
+        "     --stats               Print load statistics to stderr\n"
+        "     --queue-crossover <N> SJF/Priority queue length where the flat scan\n"
+        "                           hands over to a heap (default 192)\n"
+        "-h,  --help                Show this help message\n"
+        "\n"
+        "convert writes the CSV as a binary workload that -i loads without\n"
+        "parsing. The format is detected from the file contents.\n"
+        "bench-queue times flat scan against heap ready queues to pick\n"
+        "--queue-crossover for this machine.\n"
+        "generate writes the workload a --workload spec and --seed produce,\n"
+        "the same one a run with that --workload simulates.\n",
+        progname, progname, progname, progname);
 }
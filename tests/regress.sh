@@ -0,0 +1,139 @@
+#!/bin/sh
+# Regression checks: every alternative way of running a workload has to
+# print what the plain run (CSV input, direct engine, one thread) prints.
+#
+#   sh tests/regress.sh
+#
+# Builds schedsim into a scratch directory, prints one line per failed
+# check and exits non-zero if there was any.
+
+cd "$(dirname "$0")/.." || exit 1
+work=$(mktemp -d) || exit 1
+trap 'rm -rf "$work"' EXIT INT TERM
+sim="$work/schedsim"
+gcc -O2 -Wall -Wextra schedsim.c -o "$sim" -lpthread -lm || exit 1
+
+policies="--fcfs --sjf --rr --priority --srtf --cfs --mlfq --lottery --stride"
+failures=0
+checks=0
+
+fail() {
+    echo "FAIL: $*"
+    failures=$((failures + 1))
+}
+
+# same <what> <file a> <file b>
+same() {
+    checks=$((checks + 1))
+    cmp -s "$2" "$3" || fail "$1"
+}
+
+# The process rows of a results table, sorted (a streaming run prints
+# them in finishing order), and the summary under it
+rows() {
+    awk '/^-+$/ { n++; next } n == 2' "$1" | sort
+}
+summary() {
+    awk '/^(Avg|Throughput|Deadline|CPU Util)/ || /^(Wait|Resp|Turn)\t/' "$1"
+}
+
+# Inputs: the sample, a generated trace with heavy-tailed bursts and the
+# same trace with a deadline column, each also as a binary workload
+"$sim" generate --workload processes=3000,arrival=3,burst=pareto:1.5:2,priority=1:10 \
+    --seed 11 -o "$work/trace.csv" || exit 1
+awk -F, 'NR == 1 { print $0 ",deadline"; next } { print $0 "," (NR % 4 == 0 ? "" : $3 * 6) }' \
+    "$work/trace.csv" > "$work/deadlines.csv"
+cp processes.csv "$work/sample.csv"
+for input in sample trace deadlines; do
+    "$sim" convert -i "$work/$input.csv" -o "$work/$input.bin" || exit 1
+done
+
+# run <output> <args...>, stderr included so an error never compares equal
+run() {
+    out=$1
+    shift
+    "$sim" "$@" > "$out" 2>&1
+}
+
+# Binary workloads load the same processes as their CSV
+for input in sample trace deadlines; do
+    for policy in $policies; do
+        run "$work/csv.out" $policy -q 2 -i "$work/$input.csv"
+        run "$work/bin.out" $policy -q 2 -i "$work/$input.bin"
+        same "binary $input $policy" "$work/csv.out" "$work/bin.out"
+    done
+done
+run "$work/csv.out" --edf -i "$work/deadlines.csv"
+run "$work/bin.out" --edf -i "$work/deadlines.bin"
+same "binary deadlines --edf" "$work/csv.out" "$work/bin.out"
+
+# A corrupt binary workload is rejected, not read: a bad version, a
+# truncated column table, and an arrival column (the second entry of the
+# table, 32 + 40 bytes in) with a width of 0
+corrupt() {
+    checks=$((checks + 1))
+    if "$sim" -f -i "$1" > "$work/corrupt.out" 2>&1; then
+        fail "corrupt binary accepted: $2"
+    elif ! grep -q "corrupt\|unsupported" "$work/corrupt.out"; then
+        fail "corrupt binary not reported: $2"
+    fi
+}
+cp "$work/trace.bin" "$work/bad.bin"
+printf '\007' | dd of="$work/bad.bin" bs=1 seek=8 conv=notrunc 2> /dev/null
+corrupt "$work/bad.bin" "version"
+head -c 100 "$work/trace.bin" > "$work/bad.bin"
+corrupt "$work/bad.bin" "truncated header"
+cp "$work/trace.bin" "$work/bad.bin"
+dd if=/dev/zero of="$work/bad.bin" bs=1 seek=92 count=4 conv=notrunc 2> /dev/null
+corrupt "$work/bad.bin" "arrival width 0"
+
+# Streaming finishes every process the same way, in any input format
+for input in sample.csv trace.csv trace.bin deadlines.csv deadlines.bin; do
+    for policy in $policies --edf; do
+        case "$input,$policy" in
+            sample.csv,--edf | trace.*,--edf) continue ;;
+        esac
+        run "$work/plain.out" $policy -q 3 -i "$work/$input"
+        run "$work/stream.out" $policy -q 3 -i "$work/$input" --stream
+        rows "$work/plain.out" > "$work/a"
+        rows "$work/stream.out" > "$work/b"
+        same "stream rows $input $policy" "$work/a" "$work/b"
+        summary "$work/plain.out" > "$work/a"
+        summary "$work/stream.out" > "$work/b"
+        same "stream summary $input $policy" "$work/a" "$work/b"
+    done
+done
+
+# Per-CPU run queues give the same results on any number of host threads
+for policy in $policies; do
+    run "$work/one.out" $policy -i "$work/trace.csv" --cpus 8 --balance steal --host-threads 1
+    for threads in 2 3 8; do
+        run "$work/many.out" $policy -i "$work/trace.csv" --cpus 8 --balance steal --host-threads $threads
+        same "host threads $threads $policy" "$work/one.out" "$work/many.out"
+    done
+done
+
+# A sweep prints the same table on any number of threads
+run "$work/one.out" --sweep all --sweep-quanta 1:6 -i "$work/deadlines.csv" --sweep-threads 1
+for threads in 2 5; do
+    run "$work/many.out" --sweep all --sweep-quanta 1:6 -i "$work/deadlines.csv" --sweep-threads $threads
+    same "sweep threads $threads" "$work/one.out" "$work/many.out"
+done
+
+# And so does Monte Carlo
+run "$work/one.out" -r -q 2 --monte-carlo 40 --seed 3 --workload processes=200 --monte-carlo-threads 1
+run "$work/many.out" -r -q 2 --monte-carlo 40 --seed 3 --workload processes=200 --monte-carlo-threads 4
+same "monte carlo threads 4" "$work/one.out" "$work/many.out"
+
+# The threaded engine (one pthread per process) matches the direct one
+head -n 301 "$work/trace.csv" > "$work/short.csv"
+for input in sample.csv short.csv; do
+    for policy in $policies; do
+        run "$work/direct.out" $policy -q 2 -i "$work/$input"
+        run "$work/threaded.out" $policy -q 2 -i "$work/$input" --engine threaded
+        same "threaded engine $input $policy" "$work/direct.out" "$work/threaded.out"
+    done
+done
+
+echo "$checks checks, $failures failed"
+[ "$failures" -eq 0 ]